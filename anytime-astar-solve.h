@@ -0,0 +1,276 @@
+#pragma once
+#ifndef ANYTIME_ASTAR_SOLVE_H
+#define ANYTIME_ASTAR_SOLVE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "arena.h"
+#include "states-hash-table.h"
+#include "bucket-queue.h"
+#include "expand.h"
+#include "search-stats.h"
+
+//Anytime Repairing A* (ARA*, Likhachev, Gordon & Thrun 2003)
+//
+//Runs weighted A* (f = g + w*h) with a falling weight, keeping the closed list and
+//frontier between rounds. Each round expands a state at most once; states improved
+//after their expansion wait in an "inconsistent" list and rejoin the frontier when
+//the weight drops. A round ends once nothing on the frontier can beat the best
+//solution under the current weight, which makes that solution within w of optimal.
+//
+//Bound is the proven suboptimality of the best solution so far: its cost over the
+//lowest g + h of any state still waiting, capped by the weight. Solve stops once
+//Bound reaches TargetBound, the Deadline passes, or the search is exhausted.
+//
+//Weights are fixed point (WeightScale ths) so frontier keys stay integers for the
+//bucket queue.
+template< typename State >
+struct AnytimeAStar
+{
+	SearchStats * Stats = nullptr; //sampled every 1024 expansions when set
+
+	double InitialWeight = 3.0;
+	double WeightStep    = 0.5;  //subtracted after each round, down to 1
+	double TargetBound   = 1.0;  //stop once the solution is proven this close to optimal
+	double Deadline      = 0;    //seconds, 0 for none
+
+	//Called with each improved solution and its proven bound
+	std::function< void( const std::vector< typename State::Action > &, double ) > OnSolution;
+
+	std::size_t InitialCapacity = std::size_t(1) << 20;
+	float       MaxLoadFactor   = 0.75f;
+	bool        UseHugePages    = false;
+
+	//Progress, readable while Solve runs (e.g. from OnSolution)
+	double      Weight          = 0;
+	double      Bound           = std::numeric_limits<double>::infinity();
+	int         SolutionCost    = std::numeric_limits<int>::max();
+	std::size_t NumSolutions    = 0;
+	std::size_t NumRounds       = 0;
+	std::size_t NumExpanded     = 0;
+	std::size_t NumGenerated    = 0;
+	std::size_t NumStale        = 0;
+
+	constexpr static int WeightScale = 100;
+
+	typedef typename State::Action Action;
+
+	struct MetaData;
+	typedef std::pair< const State, MetaData > StateAndMeta;
+
+	struct MetaData
+	{
+		//Default to "infinite" distance
+		int cost_so_far = std::numeric_limits<int>::max() ;
+		int h           = -1; //filled in on first visit
+
+		Action parent_action;
+		StateAndMeta * parent_entry = nullptr;
+
+		unsigned closed_round = 0; //round that last expanded this state, 0 for none
+		bool     waiting      = false; //on the frontier or in the inconsistent list
+	};
+
+	typedef ::StatesHashTable< State, MetaData >  StatesHashTable;
+	typedef typename StatesHashTable::handle_t    handle_t;
+	typedef BucketQueue< handle_t >               PriorityQueue;
+
+	int Key( const MetaData & meta, int w ) const { return meta.cost_so_far * WeightScale + w * meta.h; }
+
+std::vector< Action > Solve( const State & initial )
+{
+	typedef std::chrono::steady_clock Clock;
+	auto start = Clock::now();
+	auto out_of_time = [&]{ return Deadline > 0 && std::chrono::duration< double >( Clock::now() - start ).count() >= Deadline; };
+
+	Arena           arena( UseHugePages );
+	StatesHashTable States( InitialCapacity, MaxLoadFactor, &arena );
+	PriorityQueue   Frontier( arena );
+	std::vector< handle_t > Inconsistent;
+	ValueHistogram  Waiting; //waiting states by g + h
+
+	NumSolutions = NumRounds = NumExpanded = NumGenerated = NumStale = 0;
+	SolutionCost = std::numeric_limits<int>::max();
+	Bound        = std::numeric_limits<double>::infinity();
+
+	int w = std::max( WeightScale, int( std::lround( InitialWeight * WeightScale ) ) );
+	int step = std::max( 1, int( std::lround( WeightStep * WeightScale ) ) );
+
+	StateAndMeta * Goal = nullptr;
+	std::vector< Action > ret;
+
+	{
+		auto handle = States.get_handle( initial );
+		MetaData & meta = States[ handle ].second;
+		meta.cost_so_far = 0;
+		meta.h           = initial.EstGoalDist();
+		meta.waiting     = true;
+		Frontier.insert( handle, Key( meta, w ), 0 );
+		Waiting.add( meta.h );
+		if( initial.IsGoal() ) Goal = &States[ handle ];
+	}
+
+	Successors< State > children;
+	std::size_t numChecks = 0;
+	bool stop = false;
+
+	for( unsigned round = 1; !stop; ++round )
+	{
+		Weight = double( w ) / WeightScale;
+		++NumRounds;
+
+		//Expand until nothing left can beat the solution under this weight
+		while( !Frontier.empty() && ( !Goal || int64_t( Goal->second.cost_so_far ) * WeightScale > int64_t( Frontier.front_f() ) ) )
+		{
+			int g = int( Frontier.front_g() );
+			StateAndMeta & state_and_meta = States[ Frontier.front() ];
+			Frontier.pop();
+
+			MetaData & meta = state_and_meta.second;
+			if( meta.cost_so_far < g || meta.closed_round == round )
+			{
+				++NumStale;
+				continue;
+			}
+			meta.closed_round = round;
+			meta.waiting      = false;
+			Waiting.remove( g + meta.h );
+			++NumExpanded;
+
+			ExpandAll( state_and_meta.first, Action{}, children );
+			for( std::size_t i = 0; i < children.size; ++i )
+			{
+				auto & action = *children.actions[i];
+				++NumGenerated;
+
+				auto new_handle = States.get_handle( children.states[i] );
+				StateAndMeta & new_state_and_meta = States[ new_handle ];
+				MetaData & new_meta = new_state_and_meta.second;
+
+				int new_cost = g + action.GetCost();
+				if( new_cost >= new_meta.cost_so_far ) continue;
+				if( new_meta.h < 0 ) new_meta.h = new_state_and_meta.first.EstGoalDist();
+
+				//Can't lead to anything better than what we have
+				if( Goal && new_cost + new_meta.h >= Goal->second.cost_so_far ) continue;
+
+				if( new_meta.waiting ) Waiting.remove( new_meta.cost_so_far + new_meta.h );
+				new_meta.cost_so_far   = new_cost;
+				new_meta.parent_action = action;
+				new_meta.parent_entry  = &state_and_meta;
+
+				if( new_state_and_meta.first.IsGoal() )
+				{
+					//Goals aren't expanded, they just set the incumbent
+					Goal = &new_state_and_meta;
+					new_meta.waiting = false;
+					continue;
+				}
+
+				Waiting.add( new_cost + new_meta.h );
+				if( new_meta.closed_round == round )
+				{
+					//Already expanded this round: wait for the next one
+					if( !new_meta.waiting ) Inconsistent.push_back( new_handle );
+				}
+				else
+					Frontier.insert( new_handle, Key( new_meta, w ), new_cost );
+				new_meta.waiting = true;
+			}
+
+			if( ( ++numChecks & 1023 ) == 0 )
+			{
+				if( out_of_time() )
+				{
+					stop = true;
+					break;
+				}
+				if( Stats && Stats->Wanted() )
+				{
+					Stats->Publish( [&]( SearchSample & s )
+					{
+						//The frontier is keyed by weighted f, so f comes from the waiting states
+						s.solver    = "anytime";
+						s.expanded  = NumExpanded;
+						s.generated = NumGenerated;
+						s.closed    = States.size();
+						s.frontier  = Frontier.size();
+						Frontier.for_each_bucket( [&]( std::size_t, std::size_t g, std::size_t n ) { s.by_g.add( int64_t( g ), n ); } );
+						for( std::size_t f = 0; f < Waiting.count.size(); ++f )
+							if( Waiting.count[f] ) s.by_f.add( int64_t( f ), Waiting.count[f] );
+						s.f_bound   = s.by_f.count.empty() ? -1 : s.by_f.base;
+						s.bytes     = { { "states", States.bytes() }, { "arena", arena.bytes_reserved() } };
+						s.values    = { { "weight", Weight }, { "bound", Bound },
+						                { "incumbent", Goal ? double( Goal->second.cost_so_far ) : -1. },
+						                { "stale", double( NumStale ) } };
+					} );
+				}
+			}
+		}
+
+		//Record an improved solution and how close to optimal it is proven to be
+		if( Goal && Goal->second.cost_so_far < SolutionCost )
+		{
+			SolutionCost = Goal->second.cost_so_far;
+			ret.clear();
+			for( StateAndMeta * node = Goal; node->second.parent_entry; node = node->second.parent_entry )
+				ret.push_back( node->second.parent_action );
+			std::reverse( ret.begin(), ret.end() );
+			++NumSolutions;
+		}
+		if( Goal )
+		{
+			int lower = Waiting.front();
+			double proven = lower >= SolutionCost ? 1.0 : double( SolutionCost ) / lower;
+			if( !stop ) proven = std::min( proven, Weight ); //the round finished, so w holds
+			if( proven < Bound )
+			{
+				Bound = proven;
+				if( OnSolution ) OnSolution( ret, Bound );
+			}
+		}
+
+		if( stop || Bound <= TargetBound || out_of_time() ) break;
+		if( w == WeightScale && Frontier.empty() ) break; //exhausted at w = 1
+
+		//Next round: lower the weight, bring back the inconsistent states and rekey the frontier
+		w = std::max( WeightScale, w - step );
+		std::vector< handle_t > open;
+		open.swap( Inconsistent );
+		while( !Frontier.empty() )
+		{
+			auto handle = Frontier.front();
+			int  g      = int( Frontier.front_g() );
+			Frontier.pop();
+			MetaData & meta = States[ handle ].second;
+			if( meta.cost_so_far == g && meta.waiting && meta.closed_round != round )
+				open.push_back( handle );
+		}
+		for( auto handle : open )
+		{
+			MetaData & meta = States[ handle ].second;
+			meta.closed_round = 0;
+			//A solution found since it was queued may have made it useless
+			if( Goal && meta.cost_so_far + meta.h >= Goal->second.cost_so_far )
+			{
+				meta.waiting = false;
+				Waiting.remove( meta.cost_so_far + meta.h );
+				continue;
+			}
+			Frontier.insert( handle, Key( meta, w ), meta.cost_so_far );
+		}
+	}
+
+	return ret;
+}
+};
+
+template< typename State > constexpr int AnytimeAStar< State >::WeightScale;
+
+#endif
@@ -0,0 +1,165 @@
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/mman.h>
+
+//Bump allocator over large mmap'd blocks, freed all at once.
+//
+//Search nodes are never freed one at a time, so there is no per-allocation
+//bookkeeping: allocate() just bumps a pointer, and release() (or the destructor)
+//unmaps every block. Containers that do give memory back (frontier buckets) go
+//through allocate_recyclable()/recycle(), which keep power of two free lists.
+//
+//With huge_pages, blocks are 2MB aligned and backed by hugetlbfs pages if the
+//system has any reserved, otherwise by transparent huge pages (Linux only).
+struct Arena
+{
+	constexpr static std::size_t HugePageSize = std::size_t(2) << 20;
+
+	explicit Arena( bool huge_pages = false, std::size_t block_size = std::size_t(64) << 20 )
+		: huge_pages( huge_pages )
+		, block_size( block_size )
+	{
+		for( auto & list : free_lists ) list = nullptr;
+	}
+
+	~Arena() { release(); }
+
+	Arena( const Arena & ) = delete;
+	Arena & operator=( const Arena & ) = delete;
+
+	void * allocate( std::size_t bytes, std::size_t align = alignof( std::max_align_t ) )
+	{
+		uintptr_t p = ( uintptr_t( cur ) + align - 1 ) & ~uintptr_t( align - 1 );
+		if( cur == nullptr || p + bytes > uintptr_t( end ) )
+		{
+			//Big requests get their own mapping so they don't waste the rest of a block
+			if( bytes > block_size / 4 )
+				return map( bytes );
+
+			cur = static_cast< char* >( map( block_size ) );
+			end = cur + block_size;
+			p   = ( uintptr_t( cur ) + align - 1 ) & ~uintptr_t( align - 1 );
+		}
+		cur = reinterpret_cast< char* >( p + bytes );
+		return reinterpret_cast< void* >( p );
+	}
+
+	void * allocate_recyclable( std::size_t bytes )
+	{
+		std::size_t c = size_class( bytes );
+		if( free_lists[c] )
+		{
+			FreeBlock * b = free_lists[c];
+			free_lists[c] = b->next;
+			return b;
+		}
+		return allocate( std::size_t(1) << c, std::size_t(1) << ( c < 4 ? c : 4 ) );
+	}
+
+	void recycle( void * p, std::size_t bytes )
+	{
+		std::size_t c = size_class( bytes );
+		FreeBlock * b = static_cast< FreeBlock* >( p );
+		b->next = free_lists[c];
+		free_lists[c] = b;
+	}
+
+	//Give everything back to the OS in one go
+	void release()
+	{
+		for( auto & block : blocks )
+			munmap( block.base, block.size );
+		blocks.clear();
+		cur = end = nullptr;
+		for( auto & list : free_lists ) list = nullptr;
+		reserved = 0;
+	}
+
+	std::size_t bytes_reserved() const { return reserved; }
+
+	bool        huge_pages;
+	std::size_t block_size;
+
+	private:
+	struct Block { void * base; std::size_t size; };
+	struct FreeBlock { FreeBlock * next; };
+
+	std::vector< Block > blocks;
+	char *      cur = nullptr;
+	char *      end = nullptr;
+	std::size_t reserved = 0;
+	FreeBlock * free_lists[ 64 ];
+
+	static std::size_t size_class( std::size_t bytes )
+	{
+		std::size_t c = 4; //16 bytes minimum, enough for the free list link
+		while( ( std::size_t(1) << c ) < bytes ) ++c;
+		return c;
+	}
+
+	void * map( std::size_t bytes )
+	{
+		void * p = MAP_FAILED;
+		if( huge_pages )
+		{
+			bytes = ( bytes + HugePageSize - 1 ) & ~( HugePageSize - 1 );
+#if defined( __linux__ ) && defined( MAP_HUGETLB )
+			p = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+#endif
+		}
+		if( p == MAP_FAILED )
+		{
+			//mmap only promises page alignment, so for huge pages map an extra 2MB
+			//and trim it back to the 2MB aligned range inside
+			std::size_t slack = huge_pages ? HugePageSize : 0;
+			p = mmap( nullptr, bytes + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			if( p == MAP_FAILED ) std::abort();
+			if( slack )
+			{
+				char * base    = static_cast< char* >( p );
+				char * aligned = reinterpret_cast< char* >( ( uintptr_t( base ) + HugePageSize - 1 ) & ~uintptr_t( HugePageSize - 1 ) );
+				if( aligned > base ) munmap( base, aligned - base );
+				if( base + slack > aligned ) munmap( aligned + bytes, base + slack - aligned );
+				p = aligned;
+			}
+#if defined( __linux__ ) && defined( MADV_HUGEPAGE )
+			if( huge_pages ) madvise( p, bytes, MADV_HUGEPAGE );
+#endif
+		}
+		blocks.push_back( { p, bytes } );
+		reserved += bytes;
+		return p;
+	}
+};
+
+//std allocator adaptor so containers can draw from an Arena
+template< typename T >
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	Arena * arena;
+
+	ArenaAllocator( Arena & a ) : arena( &a ) {}
+	template< typename U > ArenaAllocator( const ArenaAllocator< U > & o ) : arena( o.arena ) {}
+
+	T * allocate( std::size_t n )
+	{
+		return static_cast< T* >( arena->allocate_recyclable( n * sizeof( T ) ) );
+	}
+	void deallocate( T * p, std::size_t n )
+	{
+		arena->recycle( p, n * sizeof( T ) );
+	}
+
+	template< typename U > bool operator==( const ArenaAllocator< U > & o ) const { return arena == o.arena; }
+	template< typename U > bool operator!=( const ArenaAllocator< U > & o ) const { return arena != o.arena; }
+};
+
+#endif
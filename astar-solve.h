@@ -3,185 +3,257 @@
 #define ASTAR_SOLVE_H
 
 #include <vector>
-#include <queue>
-#include <unordered_map>
 #include <limits>
 #include <algorithm>
-#include <functional>
-
-template< typename State > 
+#include <type_traits>
+#include <cstdint>
+
+#include "arena.h"
+#include "states-hash-table.h"
+#include "bucket-queue.h"
+#include "expand.h"
+#include "checkpoint.h"
+#include "search-stats.h"
+
+//Compact = true trades the parent pointer and full Action in each node for a 32 bit
+//word holding g, the closed flag and the parent action's Index(). The path is then
+//rebuilt by undoing each action (Action::Inverse()) and looking the parent state up
+//again, so it needs reversible actions.
+//
+//With CheckpointFile set, Solve resumes from that file if it holds a search from the
+//same initial state under the same heuristic, and rewrites it when CheckpointNow is set (e.g. from a signal
+//handler) or every CheckpointInterval seconds. Nodes are saved with compact metadata
+//in handle order and the frontier as handles, so either mode can resume either's
+//file. The file is removed once Solve finishes.
+template< typename State, bool Compact = false >
 struct AStar
 { 
-	bool PrintStatus = false;
+	SearchStats * Stats = nullptr; //sampled every 100 expansions when set
+
+	//Closed list sizing: initial number of nodes and max fill of the probe array
+	std::size_t InitialCapacity = std::size_t(1) << 20;
+	float       MaxLoadFactor   = 0.75f;
+
+	//Back the node arena with huge pages (Linux)
+	bool        UseHugePages    = false;
+
+	//Search statistics, reset by each Solve
+	std::size_t NumExpanded     = 0;
+	std::size_t NumGenerated    = 0;
+	std::size_t NumDuplicates   = 0; //generated states that were already in the closed list
+	std::size_t NumReopened     = 0; //expanded states later reached by a cheaper path
+	std::size_t NumStale        = 0; //frontier entries skipped because a cheaper one superseded them
+	std::size_t NumNodes        = 0; //states stored
+	std::size_t NumBytes        = 0; //closed list bytes
+
+	const char * CheckpointFile     = nullptr;
+	double       CheckpointInterval = 0; //seconds, 0 for only when CheckpointNow is set
+	volatile std::sig_atomic_t CheckpointNow = 0; //a signal handler may set it
+	bool         Resumed            = false; //the last Solve picked up from CheckpointFile
+	std::size_t  NumCheckpoints     = 0;
 
 	typedef typename State::Action Action;
 
 	//forward declares
-	struct MetaData;
+	struct PointerMetaData;
+	struct CompactMetaData;
+	typedef typename std::conditional< Compact, CompactMetaData, PointerMetaData >::type MetaData;
 
 	typedef std::pair< const State, MetaData > StateAndMeta;
 
-	struct MetaData
+	struct PointerMetaData
 	{
 		//Default to "infinite" distance
 		int cost_so_far = std::numeric_limits<int>::max() ;
 
-		int num_references = 0;
-
 		Action parent_action;
+		bool closed = false; //expanded at cost_so_far
 		StateAndMeta * parent_entry = nullptr;
-	};
 
-	struct QueueEntry
-	{
-		std::reference_wrapper< StateAndMeta > state_and_meta;
-		int Priority;
+		int  g()         const { return cost_so_far; }
+		bool is_closed() const { return closed; }
+		void close()           { closed = true; }
 
-		bool operator<( const QueueEntry & o ) const { return Priority > o.Priority; }//Invert logic, as priority_queue returns max element according to "<"
-	};
+		//Reached at cost g via action from parent; reopens the state if it was closed
+		void set( int g, const Action & action, StateAndMeta * parent )
+		{
+			cost_so_far   = g;
+			parent_action = action;
+			parent_entry  = parent;
+			closed        = false;
+		}
 
+		Action action() const { return parent_action; }
 
-	struct StatesHashTable
-	{
-		typedef std::unordered_map< State, MetaData > HashTable;
-		//Stores 1 set of metadata about each state
-		HashTable hash_table; //Known states and their data
-		typename HashTable::reference get( const State & state )
+		template< typename Table >
+		StateAndMeta * parent( Table &, const State &, Action & action ) const
 		{
-			//unordered_map.insert returns std::pair< iterator, bool >
-			//iterator dereferences to type HashTable::reference
-			auto it_bool = hash_table.insert( { state, MetaData{} } );
-			typename HashTable::reference ret = *it_bool.first;
-			auto it = it_bool.first;
-			if( it_bool.second )
-			{
-				//Freshly inserted
-				//ret.actions = state.AvailableActions();
-			}
+			action = parent_action;
+			return parent_entry;
+		}
 
-			return ret;
+		//Point back at the parent again after a reload
+		template< typename Table >
+		void relink( Table & States, const State & state )
+		{
+			if( parent_action.Index() < Action::NumIndices )
+				parent_entry = States.find( state.Apply( parent_action.Inverse() ) );
 		}
 	};
 
-	template< typename Bucket, bool prefer_min = true >
-	struct PriorityQueue1LevelBucket
+	struct CompactMetaData
 	{
-		std::vector< Bucket > queue;
+		constexpr static unsigned IndexBits( std::size_t n ) { return n <= 1 ? 0 : 1 + IndexBits( ( n + 1 ) / 2 ); }
+
+		//Low bit closed, then the parent action's index (NumIndices for none), then g
+		constexpr static unsigned ActionShift = 1;
+		constexpr static unsigned CostShift   = ActionShift + IndexBits( Action::NumIndices + 1 );
+		constexpr static uint32_t ActionMask  = ( ( uint32_t(1) << CostShift ) - 1 ) & ~uint32_t(1);
+		constexpr static int      MaxCost     = int( ~uint32_t(0) >> CostShift ); //"infinite" distance
 
-		//Either min or max
-		std::size_t next_priority = std::numeric_limits< std::size_t >::max();
+		uint32_t bits = uint32_t( MaxCost ) << CostShift | uint32_t( Action::NumIndices ) << ActionShift;
 
-		bool empty() const
+		int  g()         const { return int( bits >> CostShift ); }
+		bool is_closed() const { return bits & 1; }
+		void close()           { bits |= 1; }
+
+		void set( int g, const Action & action, StateAndMeta * )
 		{
-			return next_priority == std::numeric_limits< std::size_t >::max();
+			bits = uint32_t( g ) << CostShift | uint32_t( action.Index() ) << ActionShift;
 		}
-		
-		auto front() -> decltype( queue[ next_priority ].front() )
+
+		Action action() const { return Action::FromIndex( ( bits & ActionMask ) >> ActionShift ); }
+
+		//Undo the parent action and find the state it came from
+		template< typename Table >
+		StateAndMeta * parent( Table & States, const State & state, Action & action ) const
 		{
-			return queue[ next_priority ].front();
+			action = this->action();
+			if( action.Index() >= Action::NumIndices ) return nullptr;
+			return States.find( state.Apply( action.Inverse() ) );
 		}
 
-		void pop_front()
-		{
-			queue[ next_priority ].pop_front();
+		template< typename Table >
+		void relink( Table &, const State & ) {}
+	};
 
-			if( prefer_min )
-			{
-				//search forward for the next non-empty bucket
-				auto ref = queue.begin();
-				auto end = queue.end();
-				auto it  = ref + next_priority;
-				while( it != end && it->empty() ) ++it;
-				if( it == end ) next_priority = std::numeric_limits< std::size_t >::max();
-				else            next_priority = it - ref;
-			}
-			else
-			{
-				//search backward
-				auto ref = queue.rend() - 1;
-				auto end = queue.rend();
-				auto it  = ref - next_priority;
+	static_assert( !Compact || Action::MaxInBranch == Action::MaxBranch, "compact metadata needs a reversible state graph" );
 
-				while( it != end && it->empty() ) ++it;
-				if( it == end ) next_priority = std::numeric_limits< std::size_t >::max();
-				else            next_priority = ref - it;
+	//Stores 1 set of metadata about each state
+	typedef ::StatesHashTable< State, MetaData > StatesHashTable;
 
-			}
-		}
+	//Open list of node handles into StatesHashTable, lowest f (then highest g) first
+	typedef BucketQueue< typename StatesHashTable::handle_t > PriorityQueue;
 
-		Bucket & get_bucket( std::size_t priority )
-		{
-			if( priority >= queue.size() )
-				queue.resize( priority + 1 );
+	typedef typename StatesHashTable::handle_t handle_t;
 
-			if( prefer_min )
-			{
-				if( priority < next_priority )
-					next_priority = priority;
-			}
-			else
-			{
-				if( priority > next_priority || empty() )
-					next_priority = priority;
-			}
-			return queue[ priority ];
-
-		}
-	};
+	//Checkpoint records
+	struct NodeRecord     { State state; CompactMetaData meta; };
+	struct FrontierRecord { handle_t handle; uint32_t f, g; };
+	struct StatsRecord    { uint64_t expanded, generated, duplicates, reopened, stale; };
 
-	struct PriorityQueue : public 
-		PriorityQueue1LevelBucket< 
-			PriorityQueue1LevelBucket< 
-				std::deque< std::reference_wrapper< StateAndMeta > >, true   //Inner queue prefers max
-			> >
+	bool SaveCheckpoint( StatesHashTable & States, const PriorityQueue & Frontier, const State & initial )
 	{
-		std::size_t m_size = 0;
-		std::size_t size() const { return m_size; }
+		CheckpointWriter out( CheckpointFile, "astar", sizeof( State ), CheckpointHeuristic< State >( 0 ) );
+		out.Write( initial );
+		out.Write( StatsRecord{ NumExpanded, NumGenerated, NumDuplicates, NumReopened, NumStale } );
 
-		void pop()
+		out.template Section< NodeRecord >( States.size() );
+		for( handle_t h = 0; h < States.size(); ++h )
 		{
-			m_size--;
-			this->pop_front();
+			const StateAndMeta & node = States[h];
+			NodeRecord rec{ node.first, {} };
+			rec.meta.set( node.second.g(), node.second.action(), nullptr );
+			if( node.second.is_closed() ) rec.meta.close();
+			out.Put( rec );
 		}
 
-		void insert( StateAndMeta & value, std::size_t f, std::size_t g )
+		out.template Section< FrontierRecord >( Frontier.size() );
+		Frontier.for_each( [&]( handle_t h, std::size_t f, std::size_t g ) { out.Put( FrontierRecord{ h, uint32_t( f ), uint32_t( g ) } ); } );
+
+		++NumCheckpoints;
+		return out.Commit();
+	}
+
+	//Refills the (empty) closed list and frontier; false if there's no usable checkpoint
+	bool LoadCheckpoint( StatesHashTable & States, PriorityQueue & Frontier, const State & initial )
+	{
+		CheckpointReader in( CheckpointFile, "astar", sizeof( State ), CheckpointHeuristic< State >( 0 ) );
+		State       saved;
+		StatsRecord stats;
+		//The estimate check catches a heuristic change CheckpointHeuristic can't see
+		if( !in.Read( saved ) || !( saved == initial ) || saved.EstGoalDist() != initial.EstGoalDist() || !in.Read( stats ) ) return false;
+
+		std::size_t num_nodes, num_open;
+		const NodeRecord *     nodes = in.template ReadArray< NodeRecord >( num_nodes );
+		const FrontierRecord * open  = in.template ReadArray< FrontierRecord >( num_open );
+		if( !nodes || !open || num_nodes == 0 || !( nodes[0].state == initial ) ) return false;
+
+		//Handles are handed out in insertion order, so they come back the same
+		for( std::size_t i = 0; i < num_nodes; ++i )
 		{
-			m_size++;
-			this->get_bucket( f ).get_bucket( g ).push_back( value );
+			MetaData & meta = States.get( nodes[i].state ).second;
+			meta.set( nodes[i].meta.g(), nodes[i].meta.action(), nullptr );
+			if( nodes[i].meta.is_closed() ) meta.close();
 		}
-
-	};
+		for( handle_t h = 0; h < num_nodes; ++h )
+			States[h].second.relink( States, States[h].first );
+
+		for( std::size_t i = 0; i < num_open; ++i )
+			if( open[i].handle < num_nodes )
+				Frontier.insert( open[i].handle, open[i].f, open[i].g );
+
+		NumExpanded   = stats.expanded;
+		NumGenerated  = stats.generated;
+		NumDuplicates = stats.duplicates;
+		NumReopened   = stats.reopened;
+		NumStale      = stats.stale;
+		return true;
+	}
 
 
 std::vector< Action > Solve( const State & initial )
 {
 
-	StatesHashTable                         States;
-	PriorityQueue Frontier;
+	//All nodes and frontier buckets come from here and are released together on return
+	Arena                                   arena( UseHugePages );
 
+	StatesHashTable                         States( InitialCapacity, MaxLoadFactor, &arena );
+	PriorityQueue Frontier( arena );
 
-	//Add the initial state at 0 cost, returning iterator
-	StateAndMeta & initial_state_and_meta = States.get( initial );
-	initial_state_and_meta.second.cost_so_far = 0;
 
-	//Create priority queue
+	NumExpanded = NumGenerated = NumDuplicates = NumReopened = NumStale = NumCheckpoints = 0;
 
-	//Add initial state
-	Frontier.insert( initial_state_and_meta, 0, 0 );
+	Resumed = CheckpointFile && LoadCheckpoint( States, Frontier, initial );
+	if( !Resumed )
+	{
+		//Add the initial state at 0 cost
+		auto initial_handle = States.get_handle( initial );
+		States[ initial_handle ].second.set( 0, Action{}, nullptr );
+		Frontier.insert( initial_handle, 0, 0 );
+	}
 
-	StateAndMeta * Final = &initial_state_and_meta;
+	StateAndMeta * Final = &States.get( initial );
 
 	std::size_t numChecks = 0;
+	CheckpointSchedule schedule;
+	Successors< State > children;
 
 	while( !Frontier.empty() )
 	{
-		StateAndMeta & state_and_meta = Frontier.front();
-		Frontier.pop();//Ok to keep state_and_meta since Frontier only stores a reference_wrapper
+		int g = int( Frontier.front_g() );
+		StateAndMeta & state_and_meta = States[ Frontier.front() ];
+		Frontier.pop();//Ok to keep state_and_meta since nodes never move
 
 		const State & state = state_and_meta.first;
 		MetaData    & meta  = state_and_meta.second;
 
-		meta.num_references--;
+		//Queued before a cheaper path to this state was found, which has its own entry
+		if( meta.g() < g )
+		{
+			++NumStale;
+			continue;
+		}
 
 		if( state.IsGoal() )
 		{
@@ -189,53 +261,74 @@ std::vector< Action > Solve( const State & initial )
 			break;
 		}
 
-		//if( meta.num_references > 0 ) continue;
+		meta.close();
+		++NumExpanded;
 
-		for( auto &paction : state.AvailableActions() )
+		//See what the new states are after applying each action
+		ExpandAll( state, Action{}, children );
+		for( std::size_t i = 0; i < children.size; ++i )
 		{
-			if( !paction ) continue;
-			auto & action = *paction;
-
-			//See what the new state is after applying the action
-			State new_state   = state.Apply( action );
+			auto & action          = *children.actions[i];
+			const State & new_state = children.states[i];
+			++NumGenerated;
 
-			//inserts if doesn't exist and returns reference
-			StateAndMeta & new_state_and_meta = States.get( new_state );
+			//inserts if doesn't exist and returns handle
+			bool inserted;
+			auto new_handle = States.get_handle( new_state, inserted );
+			StateAndMeta & new_state_and_meta = States[ new_handle ];
+			if( !inserted ) ++NumDuplicates;
 
 			MetaData    & new_meta  = new_state_and_meta.second;
 
-			int new_cost = meta.cost_so_far + action.GetCost(); //g
-			if( new_cost < new_meta.cost_so_far )
+			int new_cost = g + action.GetCost();
+			if( new_cost < new_meta.g() )
 			{
-				new_meta.cost_so_far = new_cost;
-				new_meta.parent_action = action;
-				new_meta.parent_entry  = &state_and_meta;
-				new_meta.num_references++;
+				if( new_meta.is_closed() ) ++NumReopened;
+				new_meta.set( new_cost, action, &state_and_meta );
 
 				int new_priority = new_cost + new_state.EstGoalDist();
-				Frontier.insert( new_state_and_meta, new_priority, new_cost );
+				Frontier.insert( new_handle, new_priority, new_cost );
 			}
 
 		}
 
-		if( ++numChecks % 100 == 0 && PrintStatus ) 
+		if( ++numChecks % 100 == 0 && Stats && Stats->Wanted() )
 		{
-			PrintStatus = false;
-			std::cerr << " Node evaluations: " << numChecks  
-				 	  << " Queue size: "       << Frontier.size()
-				 	  << " Nodes size: "       << States.hash_table.size()
-					  << std::endl;
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				s.solver     = Compact ? "astar-compact" : "astar";
+				s.expanded   = NumExpanded;
+				s.generated  = NumGenerated;
+				s.duplicates = NumDuplicates;
+				s.reopened   = NumReopened;
+				s.closed     = States.size();
+				s.AddFrontier( Frontier );
+				s.bytes      = { { "states", States.bytes() }, { "arena", arena.bytes_reserved() } };
+				s.values     = { { "stale", double( NumStale ) } };
+			} );
+		}
+
+		if( CheckpointFile && numChecks % 1024 == 0 && schedule.Due( CheckpointNow, CheckpointInterval ) )
+		{
+			bool ok = SaveCheckpoint( States, Frontier, initial );
+			std::cerr << ( ok ? " Checkpointed " : " Failed to checkpoint " ) << States.size() << " nodes to " << CheckpointFile << std::endl;
 		}
 	}
 
-	//Now, walk backwards via parent_entry, adding the parent_action each time
+	if( CheckpointFile ) unlink( CheckpointFile );
+
+	NumNodes = States.size();
+	NumBytes = States.bytes();
+
+	//Now, walk backwards to the initial state, adding the parent action each time
 	std::vector< Action > ret;
-	if( Final ) ret.reserve( Final->second.cost_so_far + 1 );
+	ret.reserve( Final->second.g() + 1 );
 	while( Final )
 	{
-		if( Final->second.parent_entry )
-			ret.push_back( Final->second.parent_action );
-		Final = Final->second.parent_entry;
+		Action action;
+		StateAndMeta * parent = Final->second.parent( States, Final->first, action );
+		if( parent ) ret.push_back( action );
+		Final = parent;
 	}
 	std::reverse( ret.begin(), ret.end() );
 
@@ -0,0 +1,491 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <new>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include "sliding-puzzle.h"
+#include "sliding-k-puzzle.h"
+
+#include "astar-solve.h"
+#include "anytime-astar-solve.h"
+#include "bidirectional-solve.h"
+#include "external-astar-solve.h"
+#include "hdastar-solve.h"
+#include "idastar-solve.h"
+#include "idastar-inplace-solve.h"
+#include "pidastar-solve.h"
+#include "rbfs-solve.h"
+#include "smastar-solve.h"
+
+//Benchmark driver: runs every chosen solver on every instance of the chosen sets and
+//writes one record per run (JSON array or CSV) for comparing builds.
+//
+//Each run is a forked child, so a crash, the time limit (SIGALRM) or the memory limit
+//(RLIMIT_AS) only loses that run, and the child's peak RSS comes from wait4().
+//Instances come from a fixed seed, so the same arguments give the same instances.
+//
+//Sets:
+//  korf100    Korf's 100 15-puzzle instances, read from --korf100 FILE: one instance
+//             per line, optionally an id then the 16 cells row major, 0 the blank
+//  walk4x4    random walks of --walk moves from the 4x4 goal
+//  random4x4  uniformly random solvable 4x4 boards
+//  walk5x5    random walks of --walk moves from the 5x5 goal
+//  random5x5  uniformly random solvable 5x5 boards (hopeless without --pdb)
+//  sliding2   random walks on a 4x4 board with two blanks
+//  random2    uniformly random 4x4 boards with two blanks
+//
+//--solvers takes a comma separated list of solver names, or all for every solver.
+struct Options
+{
+	std::vector< std::string > sets    = { "korf100", "walk4x4", "walk5x5", "sliding2" };
+	std::vector< std::string > solvers = { "astar", "anytime", "external-astar", "idastar", "idastar-tt", "idastar-inplace", "rbfs" };
+	const char * korf100 = "korf100.txt";
+	const char * pdb     = nullptr; //5x5 pattern database file
+	const char * out     = nullptr; //stdout when not set
+	bool         csv     = false;
+	unsigned     count   = 10;      //instances per generated set
+	unsigned     seed    = 1;
+	unsigned     walk    = 60;      //random walk length
+	unsigned     timeout = 60;      //seconds per run, 0 for none
+	std::size_t  memory  = 4096;    //MB of address space per run, 0 for no limit
+};
+
+template< typename State >
+struct Instance
+{
+	std::string id;
+	State       state;
+};
+
+//What a run sends back to the parent
+struct RunResult
+{
+	int      status; //0 solved, 1 no solution, 2 wrong solution, 3 out of memory
+	int      cost;
+	int      length;
+	uint64_t expanded;
+	uint64_t generated;
+	double   seconds;
+};
+
+//Written by the parent once the child is gone
+struct Record
+{
+	std::string set, instance, solver, status;
+	int         h0;
+	RunResult   result;
+	long        peak_rss_kb;
+};
+
+struct Writer
+{
+	FILE * f;
+	bool   csv;
+	bool   first = true;
+
+	Writer( FILE * f, bool csv ) : f( f ), csv( csv )
+	{
+		if( csv ) fprintf( f, "set,instance,solver,status,h0,cost,length,expanded,generated,seconds,nodes_per_second,peak_rss_kb\n" );
+		else      fprintf( f, "[\n" );
+	}
+	~Writer()
+	{
+		if( !csv ) fprintf( f, "\n]\n" );
+		fflush( f );
+	}
+
+	void Write( const Record & r )
+	{
+		const RunResult & res = r.result;
+		double nps = res.seconds > 0 ? res.expanded / res.seconds : 0;
+		if( csv )
+			fprintf( f, "%s,%s,%s,%s,%d,%d,%d,%llu,%llu,%.6f,%.0f,%ld\n",
+			         r.set.c_str(), r.instance.c_str(), r.solver.c_str(), r.status.c_str(), r.h0, res.cost, res.length,
+			         (unsigned long long)res.expanded, (unsigned long long)res.generated, res.seconds, nps, r.peak_rss_kb );
+		else
+			fprintf( f, "%s  {\"set\": \"%s\", \"instance\": \"%s\", \"solver\": \"%s\", \"status\": \"%s\", \"h0\": %d, \"cost\": %d, \"length\": %d, "
+			            "\"expanded\": %llu, \"generated\": %llu, \"seconds\": %.6f, \"nodes_per_second\": %.0f, \"peak_rss_kb\": %ld}",
+			         first ? "" : ",\n", r.set.c_str(), r.instance.c_str(), r.solver.c_str(), r.status.c_str(), r.h0, res.cost, res.length,
+			         (unsigned long long)res.expanded, (unsigned long long)res.generated, res.seconds, nps, r.peak_rss_kb );
+		first = false;
+		fflush( f );
+	}
+};
+
+//Time one Solve and collect its counters
+template< typename Solver, typename State >
+void Run( Solver & solver, const State & initial, RunResult & res, std::vector< typename State::Action > & solution )
+{
+	auto start = std::chrono::steady_clock::now();
+	solution = solver.Solve( initial );
+	res.seconds   = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+	res.expanded  = solver.NumExpanded;
+	res.generated = solver.NumGenerated;
+}
+
+//Solve with the named solver, or return false if there's no such solver. Solvers
+//that write files put them in scratch, which the parent removes after the run.
+template< typename State >
+bool Solve( const std::string & name, const State & initial, const std::string & scratch, RunResult & res, std::vector< typename State::Action > & solution )
+{
+	if     ( name == "astar"           ) { AStar< State >          s; Run( s, initial, res, solution ); }
+	else if( name == "astar-compact"   ) { AStar< State, true >    s; Run( s, initial, res, solution ); }
+	else if( name == "anytime"         ) { AnytimeAStar< State >   s; Run( s, initial, res, solution ); }
+	else if( name == "bidirectional"   ) { Bidirectional< State >  s; Run( s, initial, res, solution ); }
+	else if( name == "external-astar"  )
+	{
+		//A fixed budget, so the bucket files rather than RAM take the search
+		ExternalAStar< State > s;
+		s.MemoryBudget = std::size_t(64) << 20;
+		s.Directory    = scratch;
+		if( mkdir( scratch.c_str(), 0700 ) != 0 ) s.Directory.clear(); //fall back to a temp directory of its own
+		Run( s, initial, res, solution );
+	}
+	else if( name == "hdastar"         ) { HDAStar< State >        s; Run( s, initial, res, solution ); }
+	else if( name == "idastar"         ) { IDAStar< State >        s; Run( s, initial, res, solution ); }
+	else if( name == "idastar-tt"      ) { IDAStar< State >        s; s.TranspositionBytes = std::size_t(256) << 20; Run( s, initial, res, solution ); }
+	else if( name == "idastar-inplace" ) { IDAStarInPlace< State > s; Run( s, initial, res, solution ); }
+	else if( name == "pidastar"        ) { PIDAStar< State >       s; Run( s, initial, res, solution ); }
+	else if( name == "rbfs"            ) { RBFS< State >           s; Run( s, initial, res, solution ); }
+	else if( name == "smastar"         ) { SMAStar< State >        s; Run( s, initial, res, solution ); }
+	else return false;
+	return true;
+}
+
+//Where a run's files go: under $TMPDIR (or /tmp), named for the run's process
+std::string ScratchDir( pid_t pid )
+{
+	const char * tmp = getenv( "TMPDIR" );
+	return std::string( tmp && *tmp ? tmp : "/tmp" ) + "/bench-" + std::to_string( pid );
+}
+
+//Remove a run's scratch directory, with whatever a killed run left in it
+void RemoveScratch( const std::string & dir )
+{
+	DIR * d = opendir( dir.c_str() );
+	if( !d ) return;
+	while( dirent * entry = readdir( d ) )
+		if( strcmp( entry->d_name, "." ) != 0 && strcmp( entry->d_name, ".." ) != 0 )
+			unlink( ( dir + "/" + entry->d_name ).c_str() );
+	closedir( d );
+	rmdir( dir.c_str() );
+}
+
+//Body of the forked child: solve, check the solution, and report through fd
+template< typename State >
+void Child( const Options & opt, const std::string & solver, const State & initial, int fd )
+{
+	if( opt.timeout ) alarm( opt.timeout );
+	if( opt.memory )
+	{
+		rlimit limit;
+		limit.rlim_cur = limit.rlim_max = rlim_t( opt.memory ) << 20;
+		setrlimit( RLIMIT_AS, &limit );
+	}
+
+	RunResult res{};
+	std::vector< typename State::Action > solution;
+	try
+	{
+		Solve( solver, initial, ScratchDir( getpid() ), res, solution );
+
+		State state = initial;
+		for( auto & action : solution )
+		{
+			state = state.Apply( action );
+			res.cost += action.GetCost();
+		}
+		res.length = int( solution.size() );
+		res.status = !state.IsGoal() ? ( solution.empty() ? 1 : 2 ) : 0;
+	}
+	catch( std::bad_alloc & )
+	{
+		res.status = 3;
+	}
+	ssize_t written = write( fd, &res, sizeof( res ) );
+	_exit( written == ssize_t( sizeof( res ) ) ? 0 : 1 );
+}
+
+template< typename State >
+Record Fork( const Options & opt, const std::string & set, const std::string & solver, const Instance< State > & instance )
+{
+	Record rec{ set, instance.id, solver, "", instance.state.EstGoalDist(), RunResult{}, 0 };
+
+	int fds[2];
+	if( pipe( fds ) != 0 )
+	{
+		rec.status = "pipe failed";
+		return rec;
+	}
+	fflush( nullptr ); //don't let the child flush the parent's buffers too
+
+	pid_t pid = fork();
+	if( pid == 0 )
+	{
+		close( fds[0] );
+		Child( opt, solver, instance.state, fds[1] );
+	}
+	close( fds[1] );
+
+	bool got = read( fds[0], &rec.result, sizeof( rec.result ) ) == ssize_t( sizeof( rec.result ) );
+	close( fds[0] );
+
+	int wstatus = 0;
+	rusage usage{};
+	if( pid < 0 || wait4( pid, &wstatus, 0, &usage ) != pid )
+	{
+		rec.status = "fork failed";
+		return rec;
+	}
+	rec.peak_rss_kb = usage.ru_maxrss; //kilobytes on Linux
+	RemoveScratch( ScratchDir( pid ) );
+
+	static const char * statuses[] = { "solved", "no solution", "wrong solution", "out of memory" };
+	if( got && rec.result.status >= 0 && rec.result.status < 4 )
+		rec.status = statuses[ rec.result.status ];
+	else if( WIFSIGNALED( wstatus ) && WTERMSIG( wstatus ) == SIGALRM )
+		rec.status = "timeout";
+	else if( WIFSIGNALED( wstatus ) && WTERMSIG( wstatus ) == SIGABRT )
+		rec.status = "aborted"; //usually an mmap over the memory limit
+	else if( WIFSIGNALED( wstatus ) )
+		rec.status = "signal " + std::to_string( WTERMSIG( wstatus ) );
+	else
+		rec.status = "failed";
+	if( !got ) rec.result = RunResult{};
+	return rec;
+}
+
+template< typename State >
+void RunSet( const Options & opt, const std::string & set, const std::vector< Instance< State > > & instances, Writer & out )
+{
+	if( instances.empty() ) return;
+
+	//Set up what's built on first use (the duplicate pruning automaton) before forking,
+	//so the runs share it instead of each one paying for it in its time
+	auto actions = instances.front().state.AvailableActions( typename State::Action{} );
+	DuplicatePruner< State >::Filter( DuplicatePruner< State >::Start(), actions );
+
+	for( auto & instance : instances )
+	{
+		for( auto & solver : opt.solvers )
+		{
+			Record rec = Fork( opt, set, solver, instance );
+			out.Write( rec );
+			std::cerr << set << " " << instance.id << " " << solver << ": " << rec.status
+			          << " cost " << rec.result.cost << " expanded " << rec.result.expanded
+			          << " " << rec.result.seconds << "s " << rec.peak_rss_kb / 1024 << "MB" << std::endl;
+		}
+	}
+}
+
+//Random walk of length moves from the goal, never undoing the previous move
+template< typename State >
+State Walk( unsigned length, std::mt19937 & rng )
+{
+	State state;
+	state.init();
+	typename State::Action lastAction;
+	for( unsigned i = 0; i < length; ++i )
+	{
+		auto actions = state.AvailableActions( lastAction );
+		std::size_t count = 0;
+		while( count < actions.size() && actions[ count ] ) ++count;
+		lastAction = *actions[ rng() % count ];
+		state = state.Apply( lastAction );
+	}
+	return state;
+}
+
+//A board with a single blank is solvable when the permutation's parity matches the
+//parity of the blank's distance from its goal cell (cell 0)
+template< unsigned N, unsigned M >
+bool Solvable( const std::vector< unsigned char > & cells )
+{
+	std::size_t inversions = 0;
+	for( std::size_t i = 0; i < cells.size(); ++i )
+		for( std::size_t j = i + 1; j < cells.size(); ++j )
+			inversions += cells[j] < cells[i];
+	std::size_t blank = std::find( cells.begin(), cells.end(), 0 ) - cells.begin();
+	return inversions % 2 == ( blank / M + blank % M ) % 2;
+}
+
+template< typename State, unsigned N, unsigned M, unsigned K >
+State Uniform( std::mt19937 & rng )
+{
+	std::vector< unsigned char > cells( N * M );
+	for( unsigned i = 0; i < N * M; ++i ) cells[i] = (unsigned char)i;
+	do std::shuffle( cells.begin(), cells.end(), rng );
+	while( K == 1 && !Solvable< N, M >( cells ) ); //more than one blank: any board is solvable
+	State state;
+	state.set( cells.data() );
+	return state;
+}
+
+template< typename State, typename Make >
+std::vector< Instance< State > > Generate( const Options & opt, const std::string & set, Make make )
+{
+	//Each set gets its own stream, so adding or dropping a set doesn't change the others
+	std::seed_seq seq( set.begin(), set.end() );
+	std::vector< uint32_t > mix( 1 );
+	seq.generate( mix.begin(), mix.end() );
+	std::mt19937 rng( opt.seed ^ mix[0] );
+
+	std::vector< Instance< State > > instances;
+	for( unsigned i = 0; i < opt.count; ++i )
+		instances.push_back( { std::to_string( i ), make( rng ) } );
+	return instances;
+}
+
+bool LoadKorf100( const char * path, std::vector< Instance< SlidingPuzzleState<4,4> > > & instances )
+{
+	std::ifstream in( path );
+	if( !in ) return false;
+
+	std::string line;
+	for( unsigned lineno = 1; std::getline( in, line ); ++lineno )
+	{
+		std::istringstream fields( line );
+		std::vector< int > values;
+		for( int v; fields >> v; ) values.push_back( v );
+		if( values.empty() ) continue;
+		if( values.size() != 16 && values.size() != 17 )
+		{
+			std::cerr << path << ":" << lineno << ": expected 16 cells, optionally after an id" << std::endl;
+			return false;
+		}
+
+		std::string id = values.size() == 17 ? std::to_string( values[0] ) : std::to_string( instances.size() + 1 );
+		std::vector< unsigned char > cells( values.end() - 16, values.end() );
+		std::vector< unsigned char > sorted( cells );
+		std::sort( sorted.begin(), sorted.end() );
+		for( unsigned i = 0; i < 16; ++i )
+		{
+			if( sorted[i] != i )
+			{
+				std::cerr << path << ":" << lineno << ": not a permutation of 0..15" << std::endl;
+				return false;
+			}
+		}
+
+		SlidingPuzzleState<4,4> state;
+		state.set( cells.data() );
+		instances.push_back( { id, state } );
+	}
+	return true;
+}
+
+std::vector< std::string > Split( const char * list )
+{
+	std::vector< std::string > items;
+	std::istringstream in( list );
+	for( std::string item; std::getline( in, item, ',' ); )
+		if( !item.empty() ) items.push_back( item );
+	return items;
+}
+
+int main( int argc, char** argv )
+{
+	Options opt;
+	for( int i = 1; i < argc; ++i )
+	{
+		const char * arg = argv[i];
+		const char * val = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+		bool used = true;
+		if     ( strcmp( arg, "--csv" ) == 0 ) { opt.csv = true; used = false; }
+		else if( !val ) { std::cerr << arg << " needs a value" << std::endl; return 1; }
+		else if( strcmp( arg, "--sets"    ) == 0 ) opt.sets    = Split( val );
+		else if( strcmp( arg, "--solvers" ) == 0 ) opt.solvers = Split( val );
+		else if( strcmp( arg, "--korf100" ) == 0 ) opt.korf100 = val;
+		else if( strcmp( arg, "--pdb"     ) == 0 ) opt.pdb     = val;
+		else if( strcmp( arg, "--out"     ) == 0 ) opt.out     = val;
+		else if( strcmp( arg, "--count"   ) == 0 ) opt.count   = unsigned( atoi( val ) );
+		else if( strcmp( arg, "--seed"    ) == 0 ) opt.seed    = unsigned( atoi( val ) );
+		else if( strcmp( arg, "--walk"    ) == 0 ) opt.walk    = unsigned( atoi( val ) );
+		else if( strcmp( arg, "--timeout" ) == 0 ) opt.timeout = unsigned( atoi( val ) );
+		else if( strcmp( arg, "--memory"  ) == 0 ) opt.memory  = std::size_t( atoll( val ) );
+		else
+		{
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+		if( used ) ++i;
+	}
+
+	//Validate solver names up front rather than recording a failed run for each
+	static const char * solvers[] = { "astar", "astar-compact", "anytime", "bidirectional", "external-astar", "hdastar", "idastar", "idastar-tt", "idastar-inplace", "pidastar", "rbfs", "smastar" };
+	if( opt.solvers.size() == 1 && opt.solvers[0] == "all" )
+		opt.solvers.assign( std::begin( solvers ), std::end( solvers ) );
+	for( auto & solver : opt.solvers )
+	{
+		if( std::find( std::begin( solvers ), std::end( solvers ), solver ) == std::end( solvers ) )
+		{
+			std::cerr << "Unknown solver " << solver << std::endl;
+			return 1;
+		}
+	}
+
+	//Loaded before forking so every run shares the mapping
+	SlidingPuzzleState<5,5>::PatternDB PDB;
+	if( opt.pdb )
+	{
+		if( !PDB.Load( opt.pdb ) )
+		{
+			std::cerr << "Couldn't load pattern database " << opt.pdb << std::endl;
+			return 1;
+		}
+		SlidingPuzzleState<5,5>::PDB = &PDB;
+	}
+
+	FILE * f = opt.out ? fopen( opt.out, "w" ) : stdout;
+	if( !f )
+	{
+		std::cerr << "Couldn't write " << opt.out << std::endl;
+		return 1;
+	}
+
+	{
+		Writer out( f, opt.csv );
+		typedef SlidingPuzzleState<4,4>    Puzzle4;
+		typedef SlidingPuzzleState<5,5>    Puzzle5;
+		typedef Sliding2PuzzleState<4,4>   Puzzle4x2;
+
+		for( auto & set : opt.sets )
+		{
+			if( set == "korf100" )
+			{
+				std::vector< Instance< Puzzle4 > > instances;
+				if( !LoadKorf100( opt.korf100, instances ) )
+				{
+					std::cerr << "Skipping korf100: couldn't load " << opt.korf100 << std::endl;
+					continue;
+				}
+				RunSet( opt, set, instances, out );
+			}
+			else if( set == "walk4x4"   ) RunSet( opt, set, Generate< Puzzle4   >( opt, set, [&]( std::mt19937 & rng ){ return Walk< Puzzle4   >( opt.walk, rng ); } ), out );
+			else if( set == "random4x4" ) RunSet( opt, set, Generate< Puzzle4   >( opt, set, [&]( std::mt19937 & rng ){ return Uniform< Puzzle4, 4, 4, 1 >( rng ); } ), out );
+			else if( set == "walk5x5"   ) RunSet( opt, set, Generate< Puzzle5   >( opt, set, [&]( std::mt19937 & rng ){ return Walk< Puzzle5   >( opt.walk, rng ); } ), out );
+			else if( set == "random5x5" ) RunSet( opt, set, Generate< Puzzle5   >( opt, set, [&]( std::mt19937 & rng ){ return Uniform< Puzzle5, 5, 5, 1 >( rng ); } ), out );
+			else if( set == "sliding2"  ) RunSet( opt, set, Generate< Puzzle4x2 >( opt, set, [&]( std::mt19937 & rng ){ return Walk< Puzzle4x2 >( opt.walk, rng ); } ), out );
+			else if( set == "random2"   ) RunSet( opt, set, Generate< Puzzle4x2 >( opt, set, [&]( std::mt19937 & rng ){ return Uniform< Puzzle4x2, 4, 4, 2 >( rng ); } ), out );
+			else std::cerr << "Unknown set " << set << std::endl;
+		}
+	}
+	if( opt.out ) fclose( f );
+	return 0;
+}
@@ -0,0 +1,259 @@
+#pragma once
+#ifndef BIDIRECTIONAL_SOLVE_H
+#define BIDIRECTIONAL_SOLVE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#include "arena.h"
+#include "states-hash-table.h"
+#include "bucket-queue.h"
+#include "expand.h"
+#include "search-stats.h"
+
+//Bidirectional meet in the middle search (MM, Holte et al. 2016)
+//
+//One A* runs forward from the initial state toward the goal and one backward from
+//the goal toward the initial state. Each direction orders its frontier by
+//pr = max( f, 2g ), and the direction with the smaller minimum pr expands next.
+//Every generated state is looked up on the other side, and the best meeting
+//cost U is optimal as soon as it is no more than
+//max( min pr, min f forward, min f backward, min g forward + min g backward ).
+//
+//Needs reversible actions (Action::Inverse(), MaxInBranch == MaxBranch) to walk the
+//backward half of the path, State::init() to build the goal and
+//State::EstDistTo( target ) as the backward heuristic.
+template< typename State >
+struct Bidirectional
+{
+	SearchStats * Stats = nullptr; //sampled every 100 expansions when set
+
+	std::size_t InitialCapacity = std::size_t(1) << 20; //per direction
+	float       MaxLoadFactor   = 0.75f;
+	bool        UseHugePages    = false;
+
+	//Search statistics, summed over both directions by each Solve
+	std::size_t NumExpanded     = 0;
+	std::size_t NumGenerated    = 0;
+	std::size_t NumDuplicates   = 0;
+	std::size_t NumReopened     = 0;
+	std::size_t NumStale        = 0;
+	std::size_t NumNodes        = 0; //states stored, both directions
+	std::size_t NumBytes        = 0; //closed list bytes, both directions
+
+	typedef typename State::Action Action;
+	static_assert( Action::MaxInBranch == Action::MaxBranch, "backward search needs a reversible state graph" );
+
+	struct MetaData;
+	typedef std::pair< const State, MetaData > StateAndMeta;
+
+	struct MetaData
+	{
+		//Default to "infinite" distance
+		int cost_so_far = std::numeric_limits<int>::max() ;
+		int h           = -1; //estimate toward this direction's target, filled in on first visit
+
+		Action parent_action;
+		bool closed = false;
+		StateAndMeta * parent_entry = nullptr;
+	};
+
+	typedef ::StatesHashTable< State, MetaData >   StatesHashTable;
+	typedef typename StatesHashTable::handle_t     handle_t;
+	typedef BucketQueue< handle_t >                PriorityQueue;
+
+	struct Direction
+	{
+		Arena           arena;
+		StatesHashTable States;
+		PriorityQueue   Frontier;
+		ValueHistogram  fs, gs; //open nodes by f and g, for the frontier's minimums
+
+		const State * target; //nullptr: use EstGoalDist
+
+		Direction( const Bidirectional & s, const State * target )
+			: arena( s.UseHugePages )
+			, States( s.InitialCapacity, s.MaxLoadFactor, &arena )
+			, Frontier( arena )
+			, target( target )
+		{
+		}
+
+		int Estimate( const State & state ) const { return target ? state.EstDistTo( *target ) : state.EstGoalDist(); }
+
+		//Drop superseded entries off the top so front_f() is the real minimum pr
+		void SkipStale( std::size_t & stale )
+		{
+			while( !Frontier.empty() && States[ Frontier.front() ].second.cost_so_far < int( Frontier.front_g() ) )
+			{
+				Frontier.pop();
+				++stale;
+			}
+		}
+
+		int MinPriority() const { return Frontier.empty() ? std::numeric_limits<int>::max() : int( Frontier.front_f() ); }
+	};
+
+	//Best meeting found so far
+	int            Incumbent = std::numeric_limits<int>::max();
+	StateAndMeta * MeetForward  = nullptr;
+	StateAndMeta * MeetBackward = nullptr;
+
+	void Open( Direction & d, handle_t handle, int g, const Action & action, StateAndMeta * parent )
+	{
+		StateAndMeta & node = d.States[ handle ];
+		MetaData & meta = node.second;
+		if( meta.h < 0 )
+			meta.h = d.Estimate( node.first );
+
+		if( meta.cost_so_far != std::numeric_limits<int>::max() && !meta.closed )
+		{
+			//Still queued at its old cost
+			d.fs.remove( meta.cost_so_far + meta.h );
+			d.gs.remove( meta.cost_so_far );
+		}
+		if( meta.closed )
+		{
+			++NumReopened;
+			meta.closed = false;
+		}
+
+		meta.cost_so_far   = g;
+		meta.parent_action = action;
+		meta.parent_entry  = parent;
+
+		d.Frontier.insert( handle, std::max( g + meta.h, 2 * g ), g );
+		d.fs.add( g + meta.h );
+		d.gs.add( g );
+	}
+
+	void Meet( StateAndMeta & node, Direction & other, bool forward )
+	{
+		StateAndMeta * match = other.States.find( node.first );
+		if( !match || match->second.cost_so_far == std::numeric_limits<int>::max() ) return;
+
+		int cost = node.second.cost_so_far + match->second.cost_so_far;
+		if( cost < Incumbent )
+		{
+			Incumbent    = cost;
+			MeetForward  = forward ? &node : match;
+			MeetBackward = forward ? match : &node;
+		}
+	}
+
+	void Expand( Direction & d, Direction & other, bool forward, Successors< State > & children )
+	{
+		int g = int( d.Frontier.front_g() );
+		StateAndMeta & state_and_meta = d.States[ d.Frontier.front() ];
+		d.Frontier.pop();
+
+		MetaData & meta = state_and_meta.second;
+		d.fs.remove( g + meta.h );
+		d.gs.remove( g );
+		meta.closed = true;
+		++NumExpanded;
+
+		ExpandAll( state_and_meta.first, Action{}, children );
+		for( std::size_t i = 0; i < children.size; ++i )
+		{
+			auto & action = *children.actions[i];
+			++NumGenerated;
+
+			bool inserted;
+			auto handle = d.States.get_handle( children.states[i], inserted );
+			StateAndMeta & new_state_and_meta = d.States[ handle ];
+			if( !inserted ) ++NumDuplicates;
+
+			int new_cost = g + action.GetCost();
+			if( new_cost >= new_state_and_meta.second.cost_so_far ) continue;
+
+			Open( d, handle, new_cost, action, &state_and_meta );
+			Meet( new_state_and_meta, other, forward );
+		}
+	}
+
+std::vector< Action > Solve( const State & initial )
+{
+	NumExpanded = NumGenerated = NumDuplicates = NumReopened = NumStale = 0;
+	Incumbent    = std::numeric_limits<int>::max();
+	MeetForward  = MeetBackward = nullptr;
+
+	State goal;
+	goal.init();
+
+	Direction Forward ( *this, nullptr  );
+	Direction Backward( *this, &initial );
+
+	Open( Forward,  Forward .States.get_handle( initial ), 0, Action{}, nullptr );
+	Open( Backward, Backward.States.get_handle( goal    ), 0, Action{}, nullptr );
+	Meet( Forward.States.get( initial ), Backward, true );
+
+	Successors< State > children;
+	std::size_t numChecks = 0;
+
+	while( true )
+	{
+		Forward .SkipStale( NumStale );
+		Backward.SkipStale( NumStale );
+
+		int prF = Forward.MinPriority(), prB = Backward.MinPriority();
+		int C = std::min( prF, prB );
+		if( C == std::numeric_limits<int>::max() ) break; //both sides ran dry
+
+		//Lower bound on any path not found yet
+		int gsum = ( Forward.gs.front() == std::numeric_limits<int>::max() || Backward.gs.front() == std::numeric_limits<int>::max() )
+		         ? std::numeric_limits<int>::max() : Forward.gs.front() + Backward.gs.front();
+		int bound = std::max( { C, Forward.fs.front(), Backward.fs.front(), gsum } );
+		if( Incumbent <= bound ) break;
+
+		if( prF <= prB )
+			Expand( Forward, Backward, true, children );
+		else
+			Expand( Backward, Forward, false, children );
+
+		if( ++numChecks % 100 == 0 && Stats && Stats->Wanted() )
+		{
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				s.solver     = "bidirectional";
+				s.expanded   = NumExpanded;
+				s.generated  = NumGenerated;
+				s.duplicates = NumDuplicates;
+				s.reopened   = NumReopened;
+				s.f_bound    = bound;
+				s.frontier   = Forward.Frontier.size() + Backward.Frontier.size();
+				s.closed     = Forward.States.size() + Backward.States.size();
+				for( const Direction * d : { &Forward, &Backward } )
+				{
+					for( std::size_t v = 0; v < d->fs.count.size(); ++v ) if( d->fs.count[v] ) s.by_f.add( int64_t( v ), d->fs.count[v] );
+					for( std::size_t v = 0; v < d->gs.count.size(); ++v ) if( d->gs.count[v] ) s.by_g.add( int64_t( v ), d->gs.count[v] );
+				}
+				s.bytes      = { { "forward_states",  Forward .States.bytes() }, { "forward_arena",  Forward .arena.bytes_reserved() },
+				                 { "backward_states", Backward.States.bytes() }, { "backward_arena", Backward.arena.bytes_reserved() } };
+				s.values     = { { "incumbent", Incumbent == std::numeric_limits<int>::max() ? -1. : double( Incumbent ) },
+				                 { "stale", double( NumStale ) } };
+			} );
+		}
+	}
+
+	NumNodes = Forward.States.size() + Backward.States.size();
+	NumBytes = Forward.States.bytes() + Backward.States.bytes();
+
+	//Forward half: walk back to the initial state
+	std::vector< Action > ret;
+	for( StateAndMeta * node = MeetForward; node && node->second.parent_entry; node = node->second.parent_entry )
+		ret.push_back( node->second.parent_action );
+	std::reverse( ret.begin(), ret.end() );
+
+	//Backward half: each backward step undone takes us one move closer to the goal
+	for( StateAndMeta * node = MeetBackward; node && node->second.parent_entry; node = node->second.parent_entry )
+		ret.push_back( node->second.parent_action.Inverse() );
+
+	return ret;
+}
+};
+
+#endif
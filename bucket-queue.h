@@ -0,0 +1,243 @@
+#pragma once
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "arena.h"
+
+//Two level bucket priority queue of node handles, keyed on (f, g).
+//
+//Pops the lowest f first and, within an f, the highest g (deepest node first).
+//f layers sit in a circular window [base, base + window) that grows on demand,
+//which with a consistent heuristic is only a handful of layers wide. Non-empty
+//layers and g buckets are tracked in bitmaps, so finding the next bucket is a
+//couple of count-leading/trailing-zeros rather than a scan. A layer's buckets
+//go back to the arena as soon as it empties.
+template< typename Handle = uint32_t >
+struct BucketQueue
+{
+	typedef std::vector< Handle, ArenaAllocator< Handle > > Bucket;
+
+	struct Layer
+	{
+		std::vector< Bucket,   ArenaAllocator< Bucket > >   g;       //buckets indexed by g
+		std::vector< uint64_t, ArenaAllocator< uint64_t > > bits;    //non-empty g buckets
+		std::vector< uint64_t, ArenaAllocator< uint64_t > > summary; //non-empty words of bits
+		std::size_t count = 0;
+
+		Layer( Arena & arena ) : g( arena ), bits( arena ), summary( arena ) {}
+
+		std::size_t max_g() const
+		{
+			for( std::size_t s = summary.size(); s--; )
+			{
+				if( !summary[s] ) continue;
+				std::size_t w = s * 64 + 63 - __builtin_clzll( summary[s] );
+				return w * 64 + 63 - __builtin_clzll( bits[w] );
+			}
+			return 0;
+		}
+
+		void push( Handle h, std::size_t gval )
+		{
+			Arena & arena = *g.get_allocator().arena;
+			while( gval >= g.size() ) g.emplace_back( arena );
+			std::size_t w = gval / 64;
+			if( w >= bits.size() )    bits.resize( w + 1, 0 );
+			if( w / 64 >= summary.size() ) summary.resize( w / 64 + 1, 0 );
+
+			g[gval].push_back( h );
+			bits[w]         |= uint64_t(1) << ( gval % 64 );
+			summary[w / 64] |= uint64_t(1) << ( w % 64 );
+			++count;
+		}
+
+		void pop( std::size_t gval )
+		{
+			g[gval].pop_back();
+			--count;
+			if( g[gval].empty() )
+			{
+				std::size_t w = gval / 64;
+				bits[w] &= ~( uint64_t(1) << ( gval % 64 ) );
+				if( !bits[w] ) summary[w / 64] &= ~( uint64_t(1) << ( w % 64 ) );
+			}
+		}
+
+		void release()
+		{
+			g.clear();       g.shrink_to_fit();
+			bits.clear();    bits.shrink_to_fit();
+			summary.clear(); summary.shrink_to_fit();
+		}
+	};
+
+	BucketQueue( Arena & arena, std::size_t window = 64 )
+		: layers( arena )
+		, layer_bits( arena )
+	{
+		std::size_t w = 64;
+		while( w < window ) w *= 2;
+		resize_window( w );
+	}
+
+	bool        empty() const { return m_size == 0; }
+	std::size_t size()  const { return m_size; }
+
+	//Priority of the front element
+	std::size_t front_f() const { return base; }
+	std::size_t front_g() const { return layers[ slot( base ) ].max_g(); }
+
+	Handle front() const
+	{
+		const Layer & layer = layers[ slot( base ) ];
+		return layer.g[ layer.max_g() ].back();
+	}
+
+	void pop()
+	{
+		Layer & layer = layers[ slot( base ) ];
+		layer.pop( layer.max_g() );
+		--m_size;
+
+		if( layer.count == 0 )
+		{
+			layer.release();
+			clear_bit( slot( base ) );
+			if( m_size ) base = next_layer( base );
+		}
+	}
+
+	void insert( Handle h, std::size_t f, std::size_t g )
+	{
+		if( m_size == 0 )
+		{
+			base = top = f;
+		}
+		else if( f < base || f > top )
+		{
+			std::size_t lo = std::min( base, f );
+			std::size_t hi = std::max( top,  f );
+			if( hi - lo >= layers.size() )
+			{
+				std::size_t w = layers.size();
+				while( hi - lo >= w ) w *= 2;
+				resize_window( w );
+			}
+			base = lo;
+			top  = hi;
+		}
+
+		std::size_t s = slot( f );
+		layers[s].push( h, g );
+		layer_bits[ s / 64 ] |= uint64_t(1) << ( s % 64 );
+		++m_size;
+	}
+
+	//Calls fn( handle, f, g ) for every entry, in no particular order
+	template< typename Fn >
+	void for_each( Fn fn ) const
+	{
+		if( m_size == 0 ) return;
+		for( std::size_t f = base; f <= top; ++f )
+		{
+			const Layer & layer = layers[ slot( f ) ];
+			for( std::size_t g = 0; g < layer.g.size(); ++g )
+				for( Handle h : layer.g[g] )
+					fn( h, f, g );
+		}
+	}
+
+	//Calls fn( f, g, count ) for every non-empty bucket, in no particular order
+	template< typename Fn >
+	void for_each_bucket( Fn fn ) const
+	{
+		if( m_size == 0 ) return;
+		for( std::size_t f = base; f <= top; ++f )
+		{
+			const Layer & layer = layers[ slot( f ) ];
+			if( layer.count == 0 ) continue;
+			for( std::size_t g = 0; g < layer.g.size(); ++g )
+				if( !layer.g[g].empty() ) fn( f, g, layer.g[g].size() );
+		}
+	}
+
+	private:
+	std::vector< Layer,    ArenaAllocator< Layer > >    layers;     //circular, power of two long
+	std::vector< uint64_t, ArenaAllocator< uint64_t > > layer_bits; //non-empty layers, by slot
+	std::size_t base   = 0; //lowest non-empty f
+	std::size_t top    = 0; //>= highest non-empty f
+	std::size_t m_size = 0;
+
+	std::size_t slot( std::size_t f ) const { return f & ( layers.size() - 1 ); }
+
+	void clear_bit( std::size_t s )
+	{
+		layer_bits[ s / 64 ] &= ~( uint64_t(1) << ( s % 64 ) );
+	}
+
+	//Lowest non-empty f above f, searching the bitmap circularly from f's slot
+	std::size_t next_layer( std::size_t f ) const
+	{
+		std::size_t n     = layers.size();
+		std::size_t start = slot( f + 1 );
+		for( std::size_t dist = 0; dist < n; )
+		{
+			std::size_t s    = ( start + dist ) & ( n - 1 );
+			uint64_t    word = layer_bits[ s / 64 ] >> ( s % 64 );
+			if( word )
+				return f + 1 + dist + __builtin_ctzll( word );
+			dist += 64 - s % 64;
+		}
+		return f;
+	}
+
+	void resize_window( std::size_t w )
+	{
+		Arena & arena = *layers.get_allocator().arena;
+		decltype( layers ) old( arena );
+		old.swap( layers );
+		layers.reserve( w );
+		for( std::size_t i = 0; i < w; ++i ) layers.emplace_back( arena );
+		layer_bits.assign( w / 64, 0 );
+
+		if( m_size == 0 ) return;
+		for( std::size_t f = base; f <= top; ++f )
+		{
+			Layer & layer = old[ f & ( old.size() - 1 ) ];
+			if( layer.count == 0 ) continue;
+			std::swap( layers[ slot( f ) ], layer );
+			layer_bits[ slot( f ) / 64 ] |= uint64_t(1) << ( slot( f ) % 64 );
+		}
+	}
+};
+
+//Count of entries at each value, for the lowest value present: e.g. the minimum f or
+//g of a frontier whose queue is ordered by something else. Values are small and
+//non-negative, and the minimum only moves up between adds, so front() is amortized O(1).
+struct ValueHistogram
+{
+	std::vector< std::size_t > count;
+	std::size_t min = 0; //no values below this
+
+	void add( int v )
+	{
+		if( std::size_t( v ) >= count.size() ) count.resize( 2 * v + 1, 0 );
+		++count[v];
+		min = std::min( min, std::size_t( v ) );
+	}
+	void remove( int v ) { --count[v]; }
+
+	int front()
+	{
+		while( min < count.size() && count[min] == 0 ) ++min;
+		return min < count.size() ? int( min ) : std::numeric_limits<int>::max();
+	}
+};
+
+#endif
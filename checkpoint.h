@@ -0,0 +1,228 @@
+#pragma once
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Binary checkpoint files for resuming long solves.
+//
+//A checkpoint is a header naming the solver, the size of its State and the heuristic
+//its f values came from (see CheckpointHeuristic), followed by
+//sections of trivially copyable records. Each section is a 64 byte header (record
+//count and size) then the records, padded to 64 bytes, so a resuming process maps
+//the file and uses the records where they lie. Writes go to path + ".tmp", which is
+//renamed over path once complete, so a crash part way through leaves the previous
+//checkpoint intact.
+constexpr std::size_t CheckpointAlignment = 64;
+
+struct CheckpointHeader
+{
+	char     magic[8];
+	char     solver[16];
+	uint64_t state_bytes;
+	uint64_t heuristic;
+	char     pad[ CheckpointAlignment - 40 ];
+};
+
+struct CheckpointSectionHeader
+{
+	uint64_t count;
+	uint64_t record_bytes;
+	char     pad[ CheckpointAlignment - 16 ];
+};
+
+static_assert( sizeof( CheckpointHeader ) == CheckpointAlignment && sizeof( CheckpointSectionHeader ) == CheckpointAlignment, "headers keep records aligned" );
+
+//Which heuristic State's estimates come from: State::HeuristicId() if it has one, else 0.
+//Saved g and f values are only good under the heuristic that made them.
+template< typename State >
+auto CheckpointHeuristic( int ) -> decltype( uint64_t( State::HeuristicId() ) ) { return State::HeuristicId(); }
+template< typename State >
+uint64_t CheckpointHeuristic( long ) { return 0; }
+
+inline CheckpointHeader MakeCheckpointHeader( const char * solver, std::size_t state_bytes, uint64_t heuristic )
+{
+	CheckpointHeader header{};
+	std::memcpy( header.magic, "SSCK\0\0\0\2", 8 );
+	std::strncpy( header.solver, solver, sizeof( header.solver ) - 1 );
+	header.state_bytes = state_bytes;
+	header.heuristic   = heuristic;
+	return header;
+}
+
+struct CheckpointWriter
+{
+	CheckpointWriter( const char * path, const char * solver, std::size_t state_bytes, uint64_t heuristic )
+		: path( path )
+		, tmp( std::string( path ) + ".tmp" )
+		, f( fopen( tmp.c_str(), "wb" ) )
+	{
+		CheckpointHeader header = MakeCheckpointHeader( solver, state_bytes, heuristic );
+		ok = f && fwrite( &header, sizeof( header ), 1, f ) == 1;
+	}
+
+	~CheckpointWriter()
+	{
+		if( f )
+		{
+			fclose( f );
+			unlink( tmp.c_str() );
+		}
+	}
+
+	CheckpointWriter( const CheckpointWriter & ) = delete;
+	CheckpointWriter & operator=( const CheckpointWriter & ) = delete;
+
+	//Start a section of count records, then Put() each of them
+	template< typename T >
+	void Section( std::size_t count )
+	{
+		static_assert( std::is_trivially_copyable< T >::value, "checkpoint records are written as raw bytes" );
+		CheckpointSectionHeader section{};
+		section.count        = count;
+		section.record_bytes = sizeof( T );
+		ok = ok && Pad() && fwrite( &section, sizeof( section ), 1, f ) == 1;
+	}
+
+	template< typename T >
+	void Put( const T & record )
+	{
+		ok = ok && fwrite( &record, sizeof( T ), 1, f ) == 1;
+	}
+
+	template< typename T >
+	void Write( const T * records, std::size_t count )
+	{
+		Section< T >( count );
+		ok = ok && fwrite( records, sizeof( T ), count, f ) == count;
+	}
+
+	template< typename T >
+	void Write( const T & record ) { Write( &record, 1 ); }
+
+	//Close the file and move it into place
+	bool Commit()
+	{
+		if( !f ) return false;
+		ok = ok && Pad();
+		ok = fclose( f ) == 0 && ok;
+		f  = nullptr;
+		ok = ok && rename( tmp.c_str(), path.c_str() ) == 0;
+		if( !ok ) unlink( tmp.c_str() );
+		return ok;
+	}
+
+	private:
+	std::string path, tmp;
+	FILE *      f;
+	bool        ok;
+
+	bool Pad()
+	{
+		static const char zeros[ CheckpointAlignment ] = {};
+		std::size_t off = std::size_t( ftell( f ) ) % CheckpointAlignment;
+		return off == 0 || fwrite( zeros, 1, CheckpointAlignment - off, f ) == CheckpointAlignment - off;
+	}
+};
+
+struct CheckpointReader
+{
+	//ok is false if path doesn't exist or was written by another solver, State or heuristic
+	CheckpointReader( const char * path, const char * solver, std::size_t state_bytes, uint64_t heuristic )
+	{
+		int fd = open( path, O_RDONLY );
+		if( fd < 0 ) return;
+
+		struct stat st;
+		void * p = MAP_FAILED;
+		if( fstat( fd, &st ) == 0 && std::size_t( st.st_size ) >= sizeof( CheckpointHeader ) )
+			p = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+		if( p == MAP_FAILED ) return;
+
+		map  = p;
+		size = std::size_t( st.st_size );
+
+		CheckpointHeader expected = MakeCheckpointHeader( solver, state_bytes, heuristic );
+		ok     = std::memcmp( map, &expected, sizeof( CheckpointHeader ) ) == 0;
+		offset = sizeof( CheckpointHeader );
+	}
+
+	~CheckpointReader()
+	{
+		if( map ) munmap( map, size );
+	}
+
+	CheckpointReader( const CheckpointReader & ) = delete;
+	CheckpointReader & operator=( const CheckpointReader & ) = delete;
+
+	//The next section's records, in place; nullptr if they aren't Ts
+	template< typename T >
+	const T * ReadArray( std::size_t & count )
+	{
+		count = 0;
+		offset = ( offset + CheckpointAlignment - 1 ) & ~( CheckpointAlignment - 1 );
+		if( !ok || offset + sizeof( CheckpointSectionHeader ) > size ) return fail< T >();
+
+		const unsigned char * base = static_cast< const unsigned char* >( map );
+		const CheckpointSectionHeader & section = *reinterpret_cast< const CheckpointSectionHeader* >( base + offset );
+		offset += sizeof( CheckpointSectionHeader );
+		if( section.record_bytes != sizeof( T ) || section.count > ( size - offset ) / sizeof( T ) )
+			return fail< T >();
+
+		const T * records = reinterpret_cast< const T* >( base + offset );
+		count   = section.count;
+		offset += count * sizeof( T );
+		return records;
+	}
+
+	//A section holding exactly one T
+	template< typename T >
+	bool Read( T & record )
+	{
+		std::size_t count;
+		const T * p = ReadArray< T >( count );
+		if( !p || count != 1 ) return ok = false;
+		std::memcpy( &record, p, sizeof( T ) );
+		return true;
+	}
+
+	bool ok = false;
+
+	private:
+	void *      map    = nullptr;
+	std::size_t size   = 0;
+	std::size_t offset = 0;
+
+	template< typename T >
+	const T * fail() { ok = false; return nullptr; }
+};
+
+//Whether it's time to write: on request (cleared here), or every interval seconds when interval > 0
+struct CheckpointSchedule
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point last = Clock::now();
+
+	bool Due( volatile std::sig_atomic_t & requested, double interval )
+	{
+		auto now = Clock::now();
+		if( !requested && !( interval > 0 && std::chrono::duration< double >( now - last ).count() >= interval ) )
+			return false;
+		requested = 0;
+		last      = now;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include <array>
+#include <cstddef>
+
+//All successors of one node, built in a single call so a State can compute the
+//children's hashes and heuristic values together (e.g. with SIMD kernels).
+template< typename State >
+struct Successors
+{
+	typedef typename State::Action Action;
+
+	std::array< const Action*, Action::MaxBranch > actions;
+	std::array< State,         Action::MaxBranch > states;
+	std::size_t size = 0;
+};
+
+//Generic batch expansion: applies each available action in turn.
+//States with a batched kernel specialize this.
+template< typename State >
+struct BatchExpand
+{
+	typedef typename State::Action Action;
+
+	static void Expand( const State & state, const typename Action::Actions & actions, Successors< State > & out )
+	{
+		out.size = 0;
+		for( auto paction : actions )
+		{
+			if( !paction ) continue;
+			out.actions[ out.size ] = paction;
+			out.states [ out.size ] = state.Apply( *paction );
+			++out.size;
+		}
+	}
+};
+
+//Children of state for actions (as returned by AvailableActions, nullptrs skipped), in order
+template< typename State >
+void ExpandAll( const State & state, const typename State::Action::Actions & actions, Successors< State > & out )
+{
+	BatchExpand< State >::Expand( state, actions, out );
+}
+
+//Children of state, in AvailableActions( prevAction ) order
+template< typename State >
+void ExpandAll( const State & state, const typename State::Action & prevAction, Successors< State > & out )
+{
+	BatchExpand< State >::Expand( state, state.AvailableActions( prevAction ), out );
+}
+
+#endif
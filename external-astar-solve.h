@@ -0,0 +1,611 @@
+#pragma once
+#ifndef EXTERNAL_ASTAR_SOLVE_H
+#define EXTERNAL_ASTAR_SOLVE_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "expand.h"
+#include "search-stats.h"
+
+//External memory A* (Edelkamp, Jabbar & Schroedl 2004) with delayed duplicate detection
+//
+//The open and closed lists are files on disk, one bucket per (g, h). Buckets are
+//processed in order of f, then g. Successors of bucket (g, h) are buffered in memory
+//up to MemoryBudget and written out as sorted runs of their target (g+1, h') buckets.
+//A bucket is then made by streaming a merge of its runs, dropping duplicates within
+//it and any state already in (g-1, h) or (g-2, h), which for an undirected unit cost
+//graph and a consistent heuristic are the only places a duplicate can be.
+//
+//Records are sorted by State hash, stored as a varint hash delta followed by the raw
+//State and the Action that generated it. Layers are kept until the end, and the path
+//is rebuilt by walking back through them with Action::Inverse().
+//
+//At most MaxMergeRuns runs are open at once: a bucket with more is first merged down
+//in passes. MemoryBudget covers the buffered successors and the I/O buffers of every
+//file that can be open together (OpenFiles), which shrink to fit a small budget.
+//A file that can't be opened, read or written ends Solve with an empty path and the
+//reason in Error, and every file goes when Solve returns, however it returns.
+//
+//Needs trivially copyable State and Action, unit action costs, reversible actions and
+//a consistent heuristic.
+template< typename State >
+struct ExternalAStar
+{
+	SearchStats * Stats = nullptr; //sampled after each bucket when set
+
+	std::size_t MemoryBudget = std::size_t(64) << 20; //bytes of buffered successors and I/O buffers
+	std::size_t IOBufferSize = std::size_t(1) << 20;  //per open file, at most
+	std::size_t MaxMergeRuns = 16;                    //runs merged at once
+	bool        UseMmap      = false;                 //read runs and layers through mmap instead of read()
+	std::string Directory;                            //where bucket files go; empty for a new one under $TMPDIR or /tmp
+	bool        KeepFiles    = false;
+
+	std::string Error; //why the last Solve failed, empty if it didn't
+
+	//Search statistics, reset by each Solve
+	std::size_t NumExpanded   = 0;
+	std::size_t NumGenerated  = 0;
+	std::size_t NumDuplicates = 0; //records dropped while merging buckets
+	std::size_t NumRuns       = 0;
+	std::size_t NumMerges     = 0; //runs merged into bigger runs before their bucket
+	std::size_t BytesWritten  = 0;
+	std::size_t BytesRead     = 0;
+	double      IOSeconds     = 0; //time spent in read()/write()
+	double      WallSeconds   = 0;
+
+	typedef typename State::Action Action;
+	static_assert( std::is_trivially_copyable< State  >::value, "states are written to disk as raw bytes" );
+	static_assert( std::is_trivially_copyable< Action >::value, "actions are written to disk as raw bytes" );
+
+	struct Record
+	{
+		uint64_t hash;
+		State    state;
+		Action   action; //how state was reached from its parent
+	};
+
+	constexpr static std::size_t RecordBytes = sizeof( State ) + sizeof( Action );
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct IOError : std::runtime_error
+	{
+		IOError( const std::string & what, const std::string & path )
+			: std::runtime_error( what + " " + path + ": " + std::strerror( errno ) ) {}
+	};
+
+	//Files open at once: the runs being merged, two older layers, the layer (or run)
+	//being written, and a run spilled part way through a bucket
+	std::size_t OpenFiles() const { return std::max< std::size_t >( MaxMergeRuns, 2 ) + 4; }
+
+	//Per file buffer, shrunk so the buffers take at most half of MemoryBudget
+	std::size_t BufferSize() const
+	{
+		return std::max( std::size_t(4096), std::min( IOBufferSize, MemoryBudget / 2 / OpenFiles() ) );
+	}
+
+	//What's left of MemoryBudget for successors waiting to be written
+	std::size_t PendingBudget() const
+	{
+		std::size_t buffers = OpenFiles() * BufferSize();
+		return MemoryBudget > buffers ? MemoryBudget - buffers : BufferSize();
+	}
+
+	struct Writer
+	{
+		ExternalAStar &     s;
+		int                 fd;
+		std::vector< char > buf;
+		uint64_t            last = 0;
+		std::string         path;
+
+		Writer( ExternalAStar & s, const std::string & path )
+			: s( s )
+			, fd( open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) )
+			, path( path )
+		{
+			if( fd < 0 ) throw IOError( "Couldn't create", path );
+			buf.reserve( s.BufferSize() + 16 + RecordBytes );
+		}
+		~Writer()
+		{
+			if( fd >= 0 ) close( fd ); //unfinished: only when unwinding, and the file goes anyway
+		}
+
+		//Write out the rest and close
+		void finish()
+		{
+			flush();
+			int r = close( fd );
+			fd = -1;
+			if( r != 0 ) throw IOError( "Couldn't write", path );
+		}
+
+		void put( const Record & r )
+		{
+			//Sorted, so the hash is stored as the difference from the last one
+			for( uint64_t d = r.hash - last; ; d >>= 7 )
+			{
+				buf.push_back( char( ( d & 0x7F ) | ( d >= 0x80 ? 0x80 : 0 ) ) );
+				if( d < 0x80 ) break;
+			}
+			last = r.hash;
+			const char * p = reinterpret_cast< const char* >( &r.state );
+			buf.insert( buf.end(), p, p + sizeof( State ) );
+			p = reinterpret_cast< const char* >( &r.action );
+			buf.insert( buf.end(), p, p + sizeof( Action ) );
+			if( buf.size() >= s.BufferSize() ) flush();
+		}
+
+		void flush()
+		{
+			auto start = Clock::now();
+			std::size_t done = 0;
+			while( done < buf.size() )
+			{
+				ssize_t n = write( fd, buf.data() + done, buf.size() - done );
+				if( n < 0 && errno == EINTR ) continue;
+				if( n <= 0 ) throw IOError( "Couldn't write", path );
+				done += std::size_t( n );
+			}
+			s.IOSeconds    += std::chrono::duration< double >( Clock::now() - start ).count();
+			s.BytesWritten += done;
+			buf.clear();
+		}
+	};
+
+	struct Reader
+	{
+		ExternalAStar &     s;
+		int                 fd;
+		std::vector< char > buf;
+		const char *        pos = nullptr, * end = nullptr;
+		void *              map = nullptr;
+		std::size_t         map_size = 0;
+		uint64_t            last = 0;
+		std::string         path;
+
+		Reader( ExternalAStar & s, const std::string & path )
+			: s( s )
+			, fd( open( path.c_str(), O_RDONLY ) )
+			, path( path )
+		{
+			if( fd < 0 ) throw IOError( "Couldn't open", path );
+			struct stat st;
+			if( s.UseMmap && fstat( fd, &st ) == 0 && st.st_size > 0 )
+			{
+				map_size = std::size_t( st.st_size );
+				map = mmap( nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+				if( map == MAP_FAILED )
+					map = nullptr;
+				else
+				{
+					madvise( map, map_size, MADV_SEQUENTIAL );
+					pos = static_cast< const char* >( map );
+					end = pos + map_size;
+					s.BytesRead += map_size;
+				}
+			}
+		}
+		~Reader()
+		{
+			if( map ) munmap( map, map_size );
+			if( fd >= 0 ) close( fd );
+		}
+
+		//Make at least n bytes available, false at end of file
+		bool fill( std::size_t n )
+		{
+			if( std::size_t( end - pos ) >= n ) return true;
+			if( map ) return false;
+
+			//Slide the leftover bytes to the front and read in behind them
+			std::size_t have   = std::size_t( end - pos );
+			std::size_t offset = pos ? std::size_t( pos - buf.data() ) : 0;
+			buf.resize( std::max( buf.size(), std::max( s.BufferSize(), n ) ) );
+			std::memmove( buf.data(), buf.data() + offset, have );
+
+			auto start = Clock::now();
+			while( have < buf.size() )
+			{
+				ssize_t r = read( fd, buf.data() + have, buf.size() - have );
+				if( r < 0 && errno == EINTR ) continue;
+				if( r < 0 ) throw IOError( "Couldn't read", path );
+				if( r == 0 ) break;
+				have += std::size_t( r );
+				s.BytesRead += std::size_t( r );
+			}
+			s.IOSeconds += std::chrono::duration< double >( Clock::now() - start ).count();
+
+			pos = buf.data();
+			end = pos + have;
+			return have >= n;
+		}
+
+		bool next( Record & r )
+		{
+			uint64_t d = 0;
+			for( unsigned shift = 0; ; shift += 7 )
+			{
+				if( !fill( 1 ) ) return false;
+				unsigned char c = (unsigned char)*pos++;
+				d |= uint64_t( c & 0x7F ) << shift;
+				if( !( c & 0x80 ) ) break;
+			}
+			if( !fill( RecordBytes ) ) return false;
+			r.hash = last += d;
+			std::memcpy( &r.state,  pos, sizeof( State  ) ); pos += sizeof( State  );
+			std::memcpy( &r.action, pos, sizeof( Action ) ); pos += sizeof( Action );
+			return true;
+		}
+	};
+
+	//Reader positioned on its next record, for merging
+	struct Cursor
+	{
+		std::unique_ptr< Reader > reader;
+		Record                    rec;
+		bool                      valid = false;
+
+		void advance() { valid = reader->next( rec ); }
+	};
+
+	//Cursors on the first record of each file
+	std::vector< Cursor > OpenCursors( std::vector< std::string >::const_iterator first, std::vector< std::string >::const_iterator last )
+	{
+		std::vector< Cursor > cursors( std::size_t( last - first ) );
+		for( auto & c : cursors )
+		{
+			c.reader.reset( new Reader( *this, *first++ ) );
+			c.advance();
+		}
+		return cursors;
+	}
+
+	//Cursor with the smallest hash, nullptr once they're all done
+	static Cursor * Lowest( std::vector< Cursor > & cursors )
+	{
+		Cursor * low = nullptr;
+		for( auto & c : cursors )
+			if( c.valid && ( !low || c.rec.hash < low->rec.hash ) ) low = &c;
+		return low;
+	}
+
+	struct Bucket
+	{
+		std::vector< std::string > runs;  //successors written here, not yet merged
+		std::string                layer; //merged and deduplicated, once processed
+	};
+
+	std::map< std::pair< int, int >, Bucket > Buckets; //by (g, h)
+
+	//Successors waiting to be written, by target (g, h)
+	std::map< std::pair< int, int >, std::vector< Record > > Pending;
+	std::size_t PendingRecords = 0;
+
+	std::vector< std::string > Files;
+	std::string                Prefix;
+	std::string                TempDirectory; //made by Solve when Directory is empty
+
+	std::string NewFile( int g, int h, const char * kind )
+	{
+		std::string path = Prefix + "-g" + std::to_string( g ) + "-h" + std::to_string( h ) + "-" + kind
+		                 + std::to_string( Files.size() );
+		Files.push_back( path );
+		return path;
+	}
+
+	void SpillRuns()
+	{
+		for( auto & p : Pending )
+		{
+			auto & recs = p.second;
+			if( recs.empty() ) continue;
+			std::sort( recs.begin(), recs.end(), []( const Record & a, const Record & b ){ return a.hash < b.hash; } );
+
+			std::string path = NewFile( p.first.first, p.first.second, "run" );
+			Writer w( *this, path );
+			for( auto & r : recs ) w.put( r );
+			w.finish();
+			Buckets[ p.first ].runs.push_back( path );
+			++NumRuns;
+		}
+		Pending.clear();
+		PendingRecords = 0;
+	}
+
+	void Push( const Record & r, int g, int h )
+	{
+		Pending[ { g, h } ].push_back( r );
+		if( ++PendingRecords * sizeof( Record ) >= PendingBudget() )
+			SpillRuns();
+	}
+
+	//Collect the records with hash from a sorted cursor, leaving it past them
+	static void TakeGroup( Cursor & c, uint64_t hash, std::vector< Record > & out )
+	{
+		while( c.valid && c.rec.hash < hash ) c.advance();
+		while( c.valid && c.rec.hash == hash )
+		{
+			out.push_back( c.rec );
+			c.advance();
+		}
+	}
+
+	void Remove( const std::string & path )
+	{
+		if( !KeepFiles ) unlink( path.c_str() );
+	}
+
+	//Merge bucket (g, h)'s runs MaxMergeRuns at a time until there are no more than that
+	void ReduceRuns( int g, int h, Bucket & bucket )
+	{
+		std::size_t fan_in = std::max< std::size_t >( MaxMergeRuns, 2 );
+		while( bucket.runs.size() > fan_in )
+		{
+			std::vector< std::string > merged;
+			for( auto first = bucket.runs.cbegin(); first != bucket.runs.cend(); )
+			{
+				auto last = first + std::min< std::ptrdiff_t >( fan_in, bucket.runs.cend() - first );
+				if( last - first == 1 )
+				{
+					merged.push_back( *first++ );
+					continue;
+				}
+
+				std::string path = NewFile( g, h, "run" );
+				{
+					std::vector< Cursor > runs = OpenCursors( first, last );
+					Writer out( *this, path );
+					while( Cursor * c = Lowest( runs ) )
+					{
+						out.put( c->rec );
+						c->advance();
+					}
+					out.finish();
+				}
+				for( ; first != last; ++first ) Remove( *first );
+				merged.push_back( path );
+				++NumMerges;
+			}
+			bucket.runs.swap( merged );
+		}
+	}
+
+	//Merge bucket (g, h) into its layer file, expanding each new state.
+	//Returns true with goal set if a goal was in it.
+	bool ProcessBucket( int g, int h, Record & goal, Successors< State > & children )
+	{
+		Bucket & bucket = Buckets[ { g, h } ];
+		ReduceRuns( g, h, bucket );
+
+		std::vector< Cursor > runs = OpenCursors( bucket.runs.cbegin(), bucket.runs.cend() );
+
+		//The layers a duplicate could be in
+		std::vector< Cursor > older;
+		for( int back = 1; back <= 2; ++back )
+		{
+			auto it = Buckets.find( { g - back, h } );
+			if( it == Buckets.end() || it->second.layer.empty() ) continue;
+			older.emplace_back();
+			older.back().reader.reset( new Reader( *this, it->second.layer ) );
+			older.back().advance();
+		}
+
+		bucket.layer = NewFile( g, h, "layer" );
+		Writer out( *this, bucket.layer );
+
+		std::vector< Record > group, seen;
+		bool found = false;
+		while( !found )
+		{
+			//Smallest hash at the head of any run
+			const Cursor * low = Lowest( runs );
+			if( !low ) break;
+			uint64_t hash = low->rec.hash;
+
+			group.clear();
+			seen.clear();
+			for( auto & c : runs  ) TakeGroup( c, hash, group );
+			for( auto & c : older ) TakeGroup( c, hash, seen );
+
+			for( auto & r : group )
+			{
+				bool dup = std::any_of( seen.begin(), seen.end(), [&]( const Record & o ){ return o.state == r.state; } );
+				if( dup )
+				{
+					++NumDuplicates;
+					continue;
+				}
+				seen.push_back( r );
+				out.put( r );
+
+				if( r.state.IsGoal() )
+				{
+					goal  = r;
+					found = true;
+					break;
+				}
+
+				++NumExpanded;
+				ExpandAll( r.state, Action{}, children );
+				for( std::size_t i = 0; i < children.size; ++i )
+				{
+					const State & child = children.states[i];
+					++NumGenerated;
+					Push( Record{ std::hash< State >()( child ), child, *children.actions[i] }, g + 1, child.EstGoalDist() );
+				}
+			}
+		}
+
+		out.finish();
+
+		//Runs are merged, they can go
+		runs.clear();
+		for( auto & path : bucket.runs ) Remove( path );
+		bucket.runs.clear();
+		return found;
+	}
+
+	//Find state in layer (g, h), returning how it was reached
+	bool FindInLayer( const State & state, int g, int h, Record & found )
+	{
+		auto it = Buckets.find( { g, h } );
+		if( it == Buckets.end() || it->second.layer.empty() ) return false;
+
+		uint64_t hash = std::hash< State >()( state );
+		Reader reader( *this, it->second.layer );
+		while( reader.next( found ) && found.hash <= hash )
+			if( found.hash == hash && found.state == state )
+				return true;
+		return false;
+	}
+
+	void Cleanup()
+	{
+		for( auto & path : Files ) Remove( path );
+		if( !KeepFiles && !TempDirectory.empty() ) rmdir( TempDirectory.c_str() );
+		TempDirectory.clear();
+		Files.clear();
+		Buckets.clear();
+		Pending.clear();
+		PendingRecords = 0;
+	}
+
+	//Files and the temporary directory go however Solve returns
+	struct CleanupGuard
+	{
+		ExternalAStar & s;
+		~CleanupGuard() { s.Cleanup(); }
+	};
+
+std::vector< Action > Solve( const State & initial )
+{
+	NumExpanded = NumGenerated = NumDuplicates = NumRuns = NumMerges = BytesWritten = BytesRead = 0;
+	IOSeconds = 0;
+	Error.clear();
+	auto start = Clock::now();
+
+	Cleanup();
+	CleanupGuard guard{ *this };
+
+	std::vector< Action > ret;
+	try
+	{
+		std::string dir = Directory;
+		if( dir.empty() )
+		{
+			const char * tmp = std::getenv( "TMPDIR" );
+			std::string templ = std::string( tmp && *tmp ? tmp : "/tmp" ) + "/extastar-XXXXXX";
+			if( !mkdtemp( &templ[0] ) ) throw IOError( "Couldn't create", templ );
+			dir = TempDirectory = templ;
+		}
+		Prefix = dir + "/extastar-" + std::to_string( getpid() );
+
+		ret = Search( initial );
+	}
+	catch( const IOError & e )
+	{
+		Error = e.what();
+		std::cerr << "External A*: " << Error << std::endl;
+		ret.clear();
+	}
+
+	WallSeconds = std::chrono::duration< double >( Clock::now() - start ).count();
+	return ret;
+}
+
+std::vector< Action > Search( const State & initial )
+{
+	std::vector< Action > ret;
+	Successors< State > children;
+
+	//Buckets are done diagonal by diagonal: all of f, lowest g first
+	Push( Record{ std::hash< State >()( initial ), initial, Action{} }, 0, initial.EstGoalDist() );
+
+	Record goal;
+	int    goal_g = -1;
+	while( goal_g < 0 )
+	{
+		//Unwritten successors have to reach disk before their bucket is merged
+		SpillRuns();
+
+		//Lowest (f, g) bucket with runs waiting
+		int best_f = std::numeric_limits<int>::max(), best_g = 0, best_h = 0;
+		for( auto & b : Buckets )
+		{
+			if( b.second.runs.empty() ) continue;
+			int g = b.first.first, h = b.first.second;
+			if( g + h < best_f || ( g + h == best_f && g < best_g ) )
+			{
+				best_f = g + h;
+				best_g = g;
+				best_h = h;
+			}
+		}
+		if( best_f == std::numeric_limits<int>::max() ) break; //no solution
+
+		if( ProcessBucket( best_g, best_h, goal, children ) )
+			goal_g = best_g;
+
+		if( Stats && Stats->Wanted() )
+		{
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				//The frontier is on disk in runs, so there's no histogram of it
+				std::size_t waiting = 0;
+				for( auto & b : Buckets ) waiting += b.second.runs.size();
+				s.solver     = "external-astar";
+				s.expanded   = NumExpanded;
+				s.generated  = NumGenerated;
+				s.duplicates = NumDuplicates;
+				s.f_bound    = best_f;
+				s.bytes      = { { "pending", PendingRecords * sizeof( Record ) }, { "buffers", OpenFiles() * BufferSize() },
+				                 { "written", BytesWritten }, { "read", BytesRead } };
+				s.values     = { { "g", double( best_g ) }, { "runs", double( NumRuns ) }, { "merges", double( NumMerges ) },
+				                 { "waiting_runs", double( waiting ) }, { "io_seconds", IOSeconds } };
+			} );
+		}
+	}
+
+	//Walk back through the layers: each record's parent is one inverse move away, a layer up
+	if( goal_g >= 0 )
+	{
+		Record rec = goal;
+		for( int g = goal_g; g > 0; --g )
+		{
+			ret.push_back( rec.action );
+			State parent = rec.state.Apply( rec.action.Inverse() );
+			if( !FindInLayer( parent, g - 1, parent.EstGoalDist(), rec ) )
+			{
+				std::cerr << "External A*: lost the path at g = " << g - 1 << std::endl;
+				ret.clear();
+				break;
+			}
+		}
+		std::reverse( ret.begin(), ret.end() );
+	}
+	return ret;
+}
+};
+
+#endif
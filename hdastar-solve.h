@@ -0,0 +1,399 @@
+#pragma once
+#ifndef HDASTAR_SOLVE_H
+#define HDASTAR_SOLVE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+
+#include "arena.h"
+#include "states-hash-table.h"
+#include "bucket-queue.h"
+#include "search-stats.h"
+
+//Hash Distributed A*
+//
+//Every state has an owning thread, picked from its hash. Each thread runs A* over
+//its own closed list and frontier, and successors owned by another thread are
+//batched up and posted to that thread's inbox (a lock-free stack of batches).
+//
+//Goals only set an incumbent cost; the search is over once no thread holds a node
+//with f below the incumbent and no batches are in flight. That is tracked with a
+//single counter of running threads plus posted-but-unprocessed batches, so a
+//thread can only wake back up while the counter is non-zero.
+template< typename State >
+struct HDAStar
+{
+	SearchStats * Stats = nullptr; //sampled by thread 0 every 64 expansions when set
+
+	unsigned    NumThreads      = std::max( 1u, std::thread::hardware_concurrency() );
+	std::size_t BatchSize       = 256;  //successors per message batch
+	std::size_t FlushInterval   = 1024; //expansions between flushing partly full batches
+
+	//Per thread closed list sizing and arena backing, as in AStar
+	std::size_t InitialCapacity = std::size_t(1) << 18;
+	float       MaxLoadFactor   = 0.75f;
+	bool        UseHugePages    = false;
+
+	//Search statistics, summed over threads by each Solve
+	std::size_t NumExpanded     = 0;
+	std::size_t NumGenerated    = 0;
+	std::size_t NumDuplicates   = 0;
+	std::size_t NumReopened     = 0;
+	std::size_t NumStale        = 0;
+	std::size_t NumSent         = 0; //successors handed to another thread
+	std::size_t MaxThreadExpanded = 0;
+	double      WallSeconds     = 0;
+
+	typedef typename State::Action Action;
+
+	struct MetaData
+	{
+		//Default to "infinite" distance
+		int cost_so_far = std::numeric_limits<int>::max() ;
+
+		Action parent_action;
+		bool closed = false;
+
+		//Parent node lives in thread parent_owner's table
+		uint32_t parent_owner  = NoParent;
+		uint32_t parent_handle = 0;
+	};
+	constexpr static uint32_t NoParent = std::numeric_limits< uint32_t >::max();
+
+	typedef ::StatesHashTable< State, MetaData >     StatesHashTable;
+	typedef typename StatesHashTable::handle_t       handle_t;
+	typedef typename StatesHashTable::StateAndMeta   StateAndMeta;
+	typedef BucketQueue< handle_t >                  PriorityQueue;
+
+	struct Message
+	{
+		State    state;
+		int      g;
+		Action   action;
+		uint32_t parent_owner;
+		handle_t parent_handle;
+	};
+
+	struct Batch
+	{
+		Batch * next = nullptr;
+		std::vector< Message > msgs;
+	};
+
+	struct Worker
+	{
+		Arena           arena;
+		StatesHashTable States;
+		PriorityQueue   Frontier;
+
+		std::vector< Batch* > outbox; //partly filled batch per destination
+
+		std::size_t Expanded = 0, Generated = 0, Duplicates = 0, Reopened = 0, Stale = 0, Sent = 0;
+
+		char pad[64]; //keep other threads' posts off the lines above
+		std::atomic< Batch* > inbox;
+
+		Worker( const HDAStar & s, unsigned threads )
+			: arena( s.UseHugePages )
+			, States( s.InitialCapacity, s.MaxLoadFactor, &arena )
+			, Frontier( arena )
+			, outbox( threads, nullptr )
+			, inbox( nullptr )
+		{
+		}
+
+		~Worker()
+		{
+			for( auto b : outbox ) delete b;
+			for( Batch * b = inbox.load(); b; )
+			{
+				Batch * next = b->next;
+				delete b;
+				b = next;
+			}
+		}
+	};
+
+	std::vector< std::unique_ptr< Worker > > Workers;
+
+	std::atomic< int >  incumbent; //cost of the best goal found so far
+	std::atomic< long > work;      //running threads + posted batches not yet processed
+
+	std::mutex goal_mutex;
+	uint32_t   goal_owner  = NoParent;
+	handle_t   goal_handle = 0;
+
+	unsigned Owner( const State & state ) const
+	{
+		uint64_t hash = std::hash< State >()( state );
+		return unsigned( ( ( hash >> 32 ) * Workers.size() ) >> 32 );
+	}
+
+	void Post( unsigned dest, Batch * b )
+	{
+		work.fetch_add( 1 );
+
+		auto & inbox = Workers[dest]->inbox;
+		b->next = inbox.load( std::memory_order_relaxed );
+		while( !inbox.compare_exchange_weak( b->next, b ) );
+	}
+
+	void Send( Worker & w, unsigned dest, const Message & msg )
+	{
+		Batch *& b = w.outbox[dest];
+		if( !b )
+		{
+			b = new Batch;
+			b->msgs.reserve( BatchSize );
+		}
+		b->msgs.push_back( msg );
+		++w.Sent;
+		if( b->msgs.size() >= BatchSize )
+		{
+			Post( dest, b );
+			b = nullptr;
+		}
+	}
+
+	void FlushAll( Worker & w )
+	{
+		for( unsigned dest = 0; dest < w.outbox.size(); ++dest )
+		{
+			if( w.outbox[dest] )
+			{
+				Post( dest, w.outbox[dest] );
+				w.outbox[dest] = nullptr;
+			}
+		}
+	}
+
+	//Offer a path of cost g to state, owned by w
+	void Relax( Worker & w, const State & state, int g, const Action & action, uint32_t parent_owner, handle_t parent_handle )
+	{
+		int f = g + state.EstGoalDist();
+		if( f >= incumbent.load( std::memory_order_relaxed ) ) return;
+
+		bool inserted;
+		auto handle = w.States.get_handle( state, inserted );
+		if( !inserted ) ++w.Duplicates;
+
+		MetaData & meta = w.States[ handle ].second;
+		if( g < meta.cost_so_far )
+		{
+			if( meta.closed )
+			{
+				++w.Reopened;
+				meta.closed = false;
+			}
+			meta.cost_so_far   = g;
+			meta.parent_action = action;
+			meta.parent_owner  = parent_owner;
+			meta.parent_handle = parent_handle;
+			w.Frontier.insert( handle, f, g );
+		}
+	}
+
+	bool HasWork( Worker & w )
+	{
+		return !w.Frontier.empty() && int( w.Frontier.front_f() ) < incumbent.load( std::memory_order_relaxed );
+	}
+
+	void Expand( Worker & w, unsigned t )
+	{
+		int g = int( w.Frontier.front_g() );
+		handle_t handle = w.Frontier.front();
+		w.Frontier.pop();
+
+		StateAndMeta & state_and_meta = w.States[ handle ];
+		const State & state = state_and_meta.first;
+		MetaData    & meta  = state_and_meta.second;
+
+		if( meta.cost_so_far < g )
+		{
+			++w.Stale;
+			return;
+		}
+
+		if( state.IsGoal() )
+		{
+			std::lock_guard< std::mutex > lock( goal_mutex );
+			if( g < incumbent.load() )
+			{
+				incumbent.store( g );
+				goal_owner  = t;
+				goal_handle = handle;
+			}
+			return;
+		}
+
+		meta.closed = true;
+		++w.Expanded;
+
+		for( auto &paction : state.AvailableActions() )
+		{
+			if( !paction ) continue;
+			auto & action = *paction;
+
+			State new_state = state.Apply( action );
+			++w.Generated;
+
+			int new_cost = meta.cost_so_far + action.GetCost();
+			if( new_cost + new_state.EstGoalDist() >= incumbent.load( std::memory_order_relaxed ) )
+				continue;
+
+			unsigned dest = Owner( new_state );
+			if( dest == t )
+				Relax( w, new_state, new_cost, action, t, handle );
+			else
+				Send( w, dest, Message{ new_state, new_cost, action, t, handle } );
+		}
+	}
+
+	void Run( unsigned t )
+	{
+		Worker & w = *Workers[t];
+		bool active = true;
+		std::size_t since_flush = 0;
+
+		while( true )
+		{
+			if( Batch * b = w.inbox.exchange( nullptr ) )
+			{
+				//The batches are still counted in work, so it can't have hit zero
+				if( !active )
+				{
+					work.fetch_add( 1 );
+					active = true;
+				}
+				long batches = 0;
+				while( b )
+				{
+					for( auto & msg : b->msgs )
+						Relax( w, msg.state, msg.g, msg.action, msg.parent_owner, msg.parent_handle );
+					Batch * next = b->next;
+					delete b;
+					b = next;
+					++batches;
+				}
+				work.fetch_sub( batches );
+			}
+
+			if( active && HasWork( w ) )
+			{
+				for( int i = 0; i < 64 && HasWork( w ); ++i )
+					Expand( w, t );
+
+				if( ( since_flush += 64 ) >= FlushInterval )
+				{
+					FlushAll( w );
+					since_flush = 0;
+				}
+
+				if( t == 0 && Stats && Stats->Wanted() )
+				{
+					//Other threads' counters aren't safe to read here, so this is thread 0's share
+					Stats->Publish( [&]( SearchSample & s )
+					{
+						s.solver     = "hdastar";
+						s.thread     = 0;
+						s.expanded   = w.Expanded;
+						s.generated  = w.Generated;
+						s.duplicates = w.Duplicates;
+						s.reopened   = w.Reopened;
+						s.closed     = w.States.size();
+						s.AddFrontier( w.Frontier );
+						s.bytes      = { { "states", w.States.bytes() }, { "arena", w.arena.bytes_reserved() } };
+						int best = incumbent.load();
+						s.values     = { { "threads", double( Workers.size() ) }, { "sent", double( w.Sent ) }, { "stale", double( w.Stale ) },
+						                 { "incumbent", best == std::numeric_limits<int>::max() ? -1. : double( best ) } };
+					} );
+				}
+				continue;
+			}
+
+			//Nothing below the incumbent: hand off what's buffered and go idle
+			FlushAll( w );
+			if( active )
+			{
+				work.fetch_sub( 1 );
+				active = false;
+			}
+			if( work.load() == 0 )
+				break;
+			std::this_thread::yield();
+		}
+	}
+
+std::vector< Action > Solve( const State & initial )
+{
+	unsigned threads = std::max( 1u, NumThreads );
+
+	Workers.clear();
+	for( unsigned t = 0; t < threads; ++t )
+		Workers.emplace_back( new Worker( *this, threads ) );
+
+	incumbent   = std::numeric_limits<int>::max();
+	work        = threads;
+	goal_owner  = NoParent;
+
+	//Add the initial state at 0 cost to its owner
+	{
+		Worker & w = *Workers[ Owner( initial ) ];
+		auto handle = w.States.get_handle( initial );
+		w.States[ handle ].second.cost_so_far = 0;
+		w.Frontier.insert( handle, initial.EstGoalDist(), 0 );
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector< std::thread > pool;
+	for( unsigned t = 1; t < threads; ++t )
+		pool.emplace_back( [this, t]{ Run( t ); } );
+	Run( 0 );
+	for( auto & thread : pool )
+		thread.join();
+
+	WallSeconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+	NumExpanded = NumGenerated = NumDuplicates = NumReopened = NumStale = NumSent = MaxThreadExpanded = 0;
+	for( auto & w : Workers )
+	{
+		NumExpanded   += w->Expanded;
+		NumGenerated  += w->Generated;
+		NumDuplicates += w->Duplicates;
+		NumReopened   += w->Reopened;
+		NumStale      += w->Stale;
+		NumSent       += w->Sent;
+		MaxThreadExpanded = std::max( MaxThreadExpanded, w->Expanded );
+	}
+
+	//Now, walk backwards across the threads' tables, adding the parent_action each time
+	std::vector< Action > ret;
+	uint32_t owner  = goal_owner;
+	handle_t handle = goal_handle;
+	while( owner != NoParent )
+	{
+		MetaData & meta = Workers[ owner ]->States[ handle ].second;
+		if( meta.parent_owner != NoParent )
+			ret.push_back( meta.parent_action );
+		owner  = meta.parent_owner;
+		handle = meta.parent_handle;
+	}
+	std::reverse( ret.begin(), ret.end() );
+
+	//Each worker's arena releases its nodes in one go
+	Workers.clear();
+
+	return ret;
+}
+};
+
+#endif
@@ -0,0 +1,173 @@
+#pragma once
+#ifndef IDASTAR_INPLACE_SOLVE_H
+#define IDASTAR_INPLACE_SOLVE_H
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include "move-fsm.h"
+#include "search-stats.h"
+
+//IDA* over a single mutable state.
+//
+//Instead of building every successor up front, each step applies one action to
+//the state in place (updating the heuristic and hash incrementally), descends, and
+//undoes it on the way back up. Frames only hold the action list, so a node costs
+//one AvailableActions call plus one apply/undo per child actually tried.
+//
+//Needs State::ApplyInPlace and State::UndoInPlace on top of the IDAStar contract.
+template< typename State >
+struct IDAStarInPlace
+{
+	SearchStats * Stats = nullptr; //sampled every 4096 steps when set
+	typedef typename State::Action Action;
+
+	std::size_t NumExpanded  = 0;
+	std::size_t NumGenerated = 0;
+
+	//Skip successors the state's duplicate pruning automaton rules out
+	bool PruneDuplicates = true;
+	typedef ::DuplicatePruner< State > Pruner;
+	typedef typename Pruner::Node      PrunerNode;
+
+	struct Frame
+	{
+		typename Action::Actions actions;
+		int next; //next entry of actions to try
+		int g;
+		PrunerNode node; //automaton state for the path to here
+	};
+
+	Frame MakeFrame( const State & state, const Action & prevAction, int g, PrunerNode node ) const
+	{
+		Frame frame{ state.AvailableActions( prevAction ), 0, g, node };
+		if( PruneDuplicates ) Pruner::Filter( node, frame.actions );
+		return frame;
+	}
+
+	//Fixed-capacity stack, regrown only when a deeper limit needs it
+	std::unique_ptr< Frame[] > Stack;
+	std::size_t StackCapacity = 0;
+
+//One depth first pass below state (reached at cost g via prevAction), pruning nodes with f > limit.
+//On finding a goal returns true with the actions from state to it in path, otherwise
+//lowers next_limit to the smallest f that was pruned. Gives up early once *stop is set.
+//state is walked back to where it started either way.
+bool Search( State & state, const Action & prevAction, int g, int limit, int & next_limit,
+             std::vector< Action > & path, const std::atomic< bool > * stop = nullptr )
+{
+	//Every action costs at least 1, so the path can't get deeper than this
+	std::size_t capacity = std::size_t( std::max( 0, limit - g ) ) + 2;
+	if( capacity > StackCapacity )
+	{
+		Stack.reset( new Frame[ capacity ] );
+		StackCapacity = capacity;
+	}
+	path.resize( capacity );
+
+	std::size_t depth = 0;
+	Stack[0] = MakeFrame( state, prevAction, g, Pruner::Start() );
+
+	std::size_t counter = 0;
+	bool found = false;
+
+	while( true )
+	{
+		if( ( ++counter & 4095 ) == 0 )
+		{
+			if( stop && stop->load( std::memory_order_relaxed ) )
+				break;
+			if( Stats && Stats->Wanted() )
+			{
+				Stats->Publish( [&]( SearchSample & s )
+				{
+					//The frontier is the siblings still to be tried along the current path,
+					//whose f isn't known until they're applied
+					s.solver    = "idastar-inplace";
+					s.expanded  = NumExpanded;
+					s.generated = NumGenerated;
+					s.f_bound   = limit;
+					for( std::size_t d = 0; d <= depth; ++d )
+					{
+						for( int i = Stack[d].next; i < int( Action::MaxBranch ); ++i )
+						{
+							if( !Stack[d].actions[i] ) continue;
+							s.by_g.add( Stack[d].g + Stack[d].actions[i]->GetCost(), 1 );
+							++s.frontier;
+						}
+					}
+					s.bytes     = { { "stack", StackCapacity * sizeof( Frame ) } };
+					s.values    = { { "depth", double( depth ) } };
+				} );
+			}
+		}
+
+		Frame & top = Stack[ depth ];
+		while( top.next < int( Action::MaxBranch ) && top.actions[ top.next ] == nullptr ) ++top.next;
+		if( top.next == int( Action::MaxBranch ) )
+		{
+			if( depth == 0 )
+				break;
+			--depth;
+			state.UndoInPlace( path[ depth ] );
+			continue;
+		}
+
+		const Action & action = *top.actions[ top.next++ ];
+		int child_g = top.g + action.GetCost();
+		state.ApplyInPlace( action );
+		++NumGenerated;
+
+		int f = child_g + state.EstGoalDist();
+		if( f > limit )
+		{
+			next_limit = std::min( next_limit, f );
+			state.UndoInPlace( action );
+			continue;
+		}
+
+		path[ depth ] = action;
+		if( state.IsGoal() )
+		{
+			found = true;
+			++depth;
+			break;
+		}
+
+		PrunerNode node = PruneDuplicates ? Pruner::Next( top.node, action ) : top.node;
+		++depth;
+		Stack[ depth ] = MakeFrame( state, action, child_g, node );
+		++NumExpanded;
+	}
+
+	//Put state back and trim path to the goal's depth (or nothing)
+	for( std::size_t d = depth; d-- > 0; )
+		state.UndoInPlace( path[ d ] );
+	path.resize( found ? depth : 0 );
+	return found;
+}
+
+std::vector< Action > Solve( const State & initial )
+{
+	std::vector< Action > ret;
+	NumExpanded = NumGenerated = 0;
+	if( initial.IsGoal() ) return ret; //No actions to do
+
+	State state = initial;
+	int limit = state.EstGoalDist();
+	while( limit != std::numeric_limits<int>::max() )
+	{
+		int next_limit = std::numeric_limits<int>::max(); //inifinity
+		if( Search( state, Action(), 0, limit, next_limit, ret ) )
+			return ret;
+		limit = next_limit;
+	}
+
+	return std::vector< Action >{};
+}
+};
+
+#endif
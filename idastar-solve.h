@@ -6,126 +6,309 @@
 #include <queue>
 #include <limits>
 #include <algorithm>
+#include <atomic>
 #include "cpp-sort/sort.h"
+#include "expand.h"
+#include "checkpoint.h"
+#include "move-fsm.h"
+#include "transposition-table.h"
+#include "search-stats.h"
 
-template< typename State > 
+//With CheckpointFile set, Solve resumes from that file if it holds a search from the
+//same initial state under the same heuristic, and rewrites it when CheckpointNow is set (e.g. from a signal
+//handler) or every CheckpointInterval seconds. A checkpoint is the current limit and
+//the position in each frame of the depth first stack; resuming rebuilds the stack
+//along that path and carries on with the next untried successor. The file is removed
+//once Solve finishes.
+//
+//With TranspositionBytes set, a lossy TranspositionTable of that size remembers, for
+//each searched subtree, the g it was reached at and the lowest f pruned below it.
+//A successor reached before at a lower g is skipped (that cheaper visit covers it),
+//and one searched before at the same g whose bound is over the limit is cut off with
+//that bound. Keys include the duplicate pruning automaton state, since that decides
+//which paths below a state get searched.
+template< typename State >
 struct IDAStar
 {
-	bool PrintStatus = false;
+	SearchStats * Stats = nullptr; //sampled every 100 steps when set
 	typedef typename State::Action Action;
 
-std::vector< Action > Solve( const State & initial )
-{
+	//Skip successors the state's duplicate pruning automaton rules out
+	bool PruneDuplicates = true;
+	typedef ::DuplicatePruner< State > Pruner;
+	typedef typename Pruner::Node      PrunerNode;
+
+	const char * CheckpointFile     = nullptr;
+	double       CheckpointInterval = 0; //seconds, 0 for only when CheckpointNow is set
+	volatile std::sig_atomic_t CheckpointNow = 0; //a signal handler may set it
+	bool         Resumed            = false; //the last Solve picked up from CheckpointFile
+	std::size_t  NumCheckpoints     = 0;
+
+	std::size_t        TranspositionBytes = 0; //0 for no table
+	TranspositionTable Table;
+	std::size_t        NumTableCutoffs    = 0;
+	std::size_t        NumExpanded        = 0;
+	std::size_t        NumGenerated       = 0;
 
 	struct StackFrame
 	{
+		//Children in the order they were generated
+		Successors< State > children;
+
+		//...and their costs, sorted
 		struct Successor
 		{
-			Action* paction;
-			State state;
+			const Action* paction;
+			std::size_t index; //into children.states
 			int g;
 			int f;
 
 			bool operator< ( const Successor & o ) const
 			{
-				//true = more first, false is more last
-				if( paction == nullptr ) 
-					return false; //nullest last
 				return f < o.f; //cheapest first
 			}
 		};
 		std::array< Successor, Action::MaxBranch > successors;
 
 		const State & state;
-		int limit; //return
 		int action_num;
+		PrunerNode node; //automaton state for the path to here
+		int g;
+		int bound = std::numeric_limits<int>::max(); //lowest f pruned below here so far
 
-		StackFrame( const State & s, const Action & prevAction, int g )
+		StackFrame( const State & s, const Action & prevAction, int g, PrunerNode node, bool prune )
 			: state( s )
-			, limit(std::numeric_limits<int>::max()) //inifinity
 			, action_num( -1 )
+			, node( node )
+			, g( g )
 		{
 			auto actions = s.AvailableActions( prevAction );
-			auto i = std::begin( successors );
-			for( auto & paction : actions )
+			if( prune ) Pruner::Filter( node, actions );
+			ExpandAll( s, actions, children );
+			for( std::size_t i = 0; i < children.size; ++i )
 			{
-				i->paction = paction;
-				if( paction )
-				{
-					i->g      = g + paction->GetCost();
-					i->state  = state.Apply( *paction );
-					i->f      = i->g + i->state.EstGoalDist();
-				}
-				++i;
+				auto & successor = successors[i];
+				successor.paction = children.actions[i];
+				successor.index   = i;
+				successor.g       = g + successor.paction->GetCost();
+				successor.f       = successor.g + children.states[i].EstGoalDist();
 			}
-			cppsort::sort( successors );
+			cppsort::sort( successors.begin(), successors.begin() + children.size );
 		}
+
+		const State & SuccessorState( const Successor & successor ) const { return children.states[ successor.index ]; }
 	};
-	std::deque< StackFrame > Stack { { StackFrame{ initial, Action(), 0 }}  };
 
-	int limit = initial.EstGoalDist();
-	int oldlimit = 0;
+	static uint64_t Key( const State & state, PrunerNode node )
+	{
+		return uint64_t( std::hash< State >()( state ) ) ^ uint64_t( node ) * 0x9E3779B97F4A7C15ull;
+	}
+
+	PrunerNode Child( const StackFrame & frame, const typename StackFrame::Successor & successor ) const
+	{
+		return PruneDuplicates ? Pruner::Next( frame.node, *successor.paction ) : frame.node;
+	}
+
+	//Checkpoint records
+	struct LimitRecord { int32_t limit, next_limit; };
+	struct FrameRecord { int32_t action_num; Action action; };
+
+	CheckpointSchedule         checkpoint_schedule;
+	std::vector< FrameRecord > resume_frames; //stack to rebuild at the start of the next Search
+
+	bool SaveCheckpoint( const State & root, int limit, int next_limit, const std::deque< StackFrame > & Stack )
+	{
+		CheckpointWriter out( CheckpointFile, "idastar", sizeof( State ), CheckpointHeuristic< State >( 0 ) );
+		out.Write( root );
+		out.Write( LimitRecord{ limit, next_limit } );
+		out.template Section< FrameRecord >( Stack.size() );
+		for( auto & SF : Stack )
+		{
+			bool taken = SF.action_num >= 0 && SF.action_num < int( SF.children.size );
+			out.Put( FrameRecord{ SF.action_num, taken ? *SF.successors[ SF.action_num ].paction : Action{} } );
+		}
+		++NumCheckpoints;
+		return out.Commit();
+	}
+
+	bool LoadCheckpoint( const State & root, int & limit, int & next_limit )
+	{
+		CheckpointReader in( CheckpointFile, "idastar", sizeof( State ), CheckpointHeuristic< State >( 0 ) );
+		State       saved;
+		LimitRecord limits;
+		std::size_t num_frames;
+		//The estimate check catches a heuristic change CheckpointHeuristic can't see
+		if( !in.Read( saved ) || !( saved == root ) || saved.EstGoalDist() != root.EstGoalDist() || !in.Read( limits ) ) return false;
+		const FrameRecord * frames = in.template ReadArray< FrameRecord >( num_frames );
+		if( !frames || num_frames == 0 ) return false;
+
+		limit      = limits.limit;
+		next_limit = limits.next_limit;
+		resume_frames.assign( frames, frames + num_frames );
+		return true;
+	}
+
+	//Walk the stack back down the checkpointed path. A frame that doesn't match
+	//(say, a different heuristic ordered the successors differently) restarts the pass.
+	void Rebuild( std::deque< StackFrame > & Stack, int limit, int & deep_g )
+	{
+		for( std::size_t i = 0; i < resume_frames.size(); ++i )
+		{
+			StackFrame & top = Stack.back();
+			const FrameRecord & rec = resume_frames[i];
+			bool last = i + 1 == resume_frames.size();
+			if( rec.action_num < -1 || rec.action_num >= int( top.children.size ) ||
+			    ( rec.action_num >= 0 && *top.successors[ rec.action_num ].paction != rec.action ) ||
+			    ( !last && rec.action_num < 0 ) )
+			{
+				while( Stack.size() > 1 ) Stack.pop_back();
+				Stack.back().action_num = -1;
+				Stack.back().bound      = std::numeric_limits<int>::max();
+				deep_g = 0;
+				break;
+			}
+			top.action_num = rec.action_num;
+			top.bound      = limit + 1; //whatever was pruned before the checkpoint was over the limit
+			if( last ) break;
+
+			auto & successor = top.successors[ rec.action_num ];
+			Stack.emplace_back( top.SuccessorState( successor ), *successor.paction, successor.g, Child( top, successor ), PruneDuplicates );
+			deep_g = std::max( deep_g, successor.g + 1 );
+		}
+		resume_frames.clear();
+	}
+
+//One depth first pass below root (reached at cost g via prevAction, with the duplicate
+//pruning automaton at rootNode), pruning nodes with f > limit.
+//On finding a goal returns true with the actions from root to it in path, otherwise
+//lowers next_limit to the smallest f that was pruned. Gives up early once *stop is set.
+bool Search( const State & root, const Action & prevAction, int g, PrunerNode rootNode, int limit, int & next_limit,
+             std::vector< Action > & path, const std::atomic< bool > * stop = nullptr )
+{
+	std::deque< StackFrame > Stack { { StackFrame{ root, prevAction, g, rootNode, PruneDuplicates }}  };
+	NumGenerated += Stack.back().children.size;
 
 	unsigned int counter = 0;
 	int deep_g = 0;
+	if( !resume_frames.empty() ) Rebuild( Stack, limit, deep_g );
 
-	while( !Stack.empty() && limit != oldlimit )
+	while( !Stack.empty() )
 	{
-		if( counter++ % 100 == 0 && PrintStatus )
+		if( ++counter % 1024 == 0 && stop && stop->load( std::memory_order_relaxed ) )
+			return false;
+		if( counter % 1024 == 0 && CheckpointFile && checkpoint_schedule.Due( CheckpointNow, CheckpointInterval ) )
+		{
+			bool ok = SaveCheckpoint( root, limit, next_limit, Stack );
+			std::cerr << ( ok ? " Checkpointed " : " Failed to checkpoint " ) << "limit " << limit << " depth " << Stack.size() << " to " << CheckpointFile << std::endl;
+		}
+		if( counter % 100 == 0 && Stats && Stats->Wanted() )
 		{
-			PrintStatus = false;
-			std::cerr << Stack.size() << " " << limit << " " << deep_g << std::endl;
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				//The frontier is the siblings still to be searched along the current path
+				s.solver    = "idastar";
+				s.expanded  = NumExpanded;
+				s.generated = NumGenerated;
+				s.pruned    = NumTableCutoffs;
+				s.f_bound   = limit;
+				for( auto & frame : Stack )
+				{
+					for( std::size_t i = std::size_t( frame.action_num + 1 ); i < frame.children.size; ++i )
+					{
+						s.by_f.add( frame.successors[i].f, 1 );
+						s.by_g.add( frame.successors[i].g, 1 );
+						++s.frontier;
+					}
+				}
+				s.bytes     = { { "stack", Stack.size() * sizeof( StackFrame ) }, { "table", Table.bytes() } };
+				s.values    = { { "depth", double( Stack.size() ) }, { "deepest_g", double( deep_g ) } };
+			} );
 		}
 		StackFrame & top = Stack.back();
 		auto & action_num = top.action_num;
 		++action_num;
 
-		//find the next non-null paction
-		for( ; action_num < int(Action::MaxBranch) && 
-				top.successors[action_num].paction == nullptr; ++action_num );
-		if( action_num == int(Action::MaxBranch) )
+		if( action_num == int( top.children.size ) )
 		{
-			if( Stack.size() == 1 )
-			{
-				//Update global limit
-				oldlimit = limit;
-				limit = top.limit;
-				//Reset top
-				top.action_num = 0;
-				top.limit = std::numeric_limits<int>::max();
-			}
-			else
-			{
-				int lim = top.limit;
-				Stack.pop_back();
-				StackFrame & t = Stack.back();
-				t.limit = std::min( t.limit, lim );
-			}
+			//Subtree done: remember its bound, and pass it up
+			int bound = top.bound;
+			Table.Store( Key( top.state, top.node ), top.g, bound );
+			Stack.pop_back();
+			if( !Stack.empty() ) Stack.back().bound = std::min( Stack.back().bound, bound );
 			continue;
 		}
 		auto &successor = top.successors[ action_num ];
 
-		if( successor.state.IsGoal() ) 
+		if( successor.f > limit )
+		{
+			next_limit = std::min( next_limit, successor.f );
+			top.bound  = std::min( top.bound, successor.f );
+			continue;
+		}
+
+		const State & successor_state = top.SuccessorState( successor );
+		if( successor_state.IsGoal() )
 		{
 			//Done!
-			std::vector< Action > ret;
-			ret.reserve( Stack.size() + 1 );
+			path.clear();
+			path.reserve( Stack.size() + 1 );
 			for( auto & SF : Stack )
-				ret.push_back( *( SF.successors[ SF.action_num ].paction ) );
-			return ret;
+				path.push_back( *( SF.successors[ SF.action_num ].paction ) );
+			return true;
 		}
 
-		if( successor.f > limit )
-			top.limit = std::min( top.limit, successor.f );
-		else
+		PrunerNode node = Child( top, successor );
+		if( const auto * entry = Table.Probe( Key( successor_state, node ) ) )
 		{
-			Stack.emplace_back( successor.state, *successor.paction, successor.g );
-			if( successor.g >= deep_g )
-				deep_g = successor.g + 1;
+			//Reached more cheaply before, or already searched from here without getting under the limit
+			if( entry->g < successor.g )
+			{
+				++NumTableCutoffs;
+				continue;
+			}
+			if( entry->g == successor.g && entry->bound > limit )
+			{
+				++NumTableCutoffs;
+				next_limit = std::min( next_limit, int( entry->bound ) );
+				top.bound  = std::min( top.bound,  int( entry->bound ) );
+				continue;
+			}
 		}
+
+		Stack.emplace_back( successor_state, *successor.paction, successor.g, node, PruneDuplicates );
+		++NumExpanded;
+		NumGenerated += Stack.back().children.size;
+		if( successor.g >= deep_g )
+			deep_g = successor.g + 1;
+	}
+
+	return false;
+}
+
+std::vector< Action > Solve( const State & initial )
+{
+	std::vector< Action > ret;
+	if( initial.IsGoal() ) return ret; //No actions to do
+
+	int limit      = initial.EstGoalDist();
+	int next_limit = std::numeric_limits<int>::max(); //inifinity
+	NumCheckpoints = NumTableCutoffs = NumExpanded = NumGenerated = 0;
+	checkpoint_schedule = CheckpointSchedule{};
+	Table.resize( TranspositionBytes );
+	Resumed = CheckpointFile && LoadCheckpoint( initial, limit, next_limit );
+
+	bool found = false;
+	while( limit != std::numeric_limits<int>::max() )
+	{
+		if( ( found = Search( initial, Action(), 0, Pruner::Start(), limit, next_limit, ret ) ) )
+			break;
+		limit      = next_limit;
+		next_limit = std::numeric_limits<int>::max();
 	}
 
-	return std::vector< Action >{};
+	if( CheckpointFile ) unlink( CheckpointFile );
+	if( !found ) ret.clear();
+	return ret;
 
 }
 };
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef LINEAR_CONFLICT_H
+#define LINEAR_CONFLICT_H
+
+#include <cstddef>
+
+//Linear conflict moves for one row or column of Len cells.
+//
+//A line is coded base Len+1, first cell most significant: each digit is the goal
+//position along the line of a tile that belongs in this line, or Len for the hole
+//and tiles that belong elsewhere. Tiles in their goal line whose goal positions
+//are out of order have to step out of the line and back, so every tile that must
+//leave to leave the rest in order (all but the longest increasing run) adds 2
+//moves to Manhattan distance.
+template< std::size_t Len >
+struct LineConflictTable
+{
+	constexpr static std::size_t Power( std::size_t b, std::size_t e ) { return e == 0 ? 1 : b * Power( b, e - 1 ); }
+	constexpr static std::size_t Size = Power( Len + 1, Len );
+
+	unsigned char extra[ Size ];
+
+	constexpr LineConflictTable() : extra{}
+	{
+		for( std::size_t code = 0; code < Size; ++code )
+		{
+			std::size_t digits[ Len ] = {};
+			std::size_t c = code;
+			for( std::size_t i = Len; i-- > 0; )
+			{
+				digits[i] = c % ( Len + 1 );
+				c /= Len + 1;
+			}
+
+			//Longest increasing subsequence of the in-line tiles
+			std::size_t run[ Len ] = {};
+			std::size_t tiles = 0, longest = 0;
+			for( std::size_t i = 0; i < Len; ++i )
+			{
+				if( digits[i] == Len ) continue;
+				++tiles;
+				run[i] = 1;
+				for( std::size_t j = 0; j < i; ++j )
+					if( digits[j] < digits[i] && run[j] + 1 > run[i] )
+						run[i] = run[j] + 1;
+				if( run[i] > longest ) longest = run[i];
+			}
+			extra[ code ] = (unsigned char)( 2 * ( tiles - longest ) );
+		}
+	}
+
+	constexpr int operator()( std::size_t code ) const { return extra[ code ]; }
+};
+
+template< std::size_t Len >
+constexpr LineConflictTable< Len > LineConflicts = LineConflictTable< Len >();
+
+#endif
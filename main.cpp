@@ -1,4 +1,7 @@
 #include <vector>
+#include <chrono>
+#include <memory>
+#include <cstdio>
 
 #include <csignal>
 #include <cstring>
@@ -7,19 +10,33 @@
 #include "sliding-puzzle.h"
 
 #include "astar-solve.h"
+#include "anytime-astar-solve.h"
+#include "bidirectional-solve.h"
+#include "external-astar-solve.h"
+#include "hdastar-solve.h"
 #include "idastar-solve.h"
+#include "idastar-inplace-solve.h"
+#include "pidastar-solve.h"
 #include "rbfs-solve.h"
+#include "smastar-solve.h"
+#include "search-stats.h"
 
 namespace
 {
 	  volatile std::sig_atomic_t gSignalStatus;
 }
 
-bool* gPrintStatus = nullptr;
+SearchStats* gStats = nullptr;
+volatile std::sig_atomic_t* gCheckpointNow = nullptr;
  
-void signal_handler(int signal)
+void signal_handler(int)
 {
-	if( gPrintStatus ) *gPrintStatus = true;
+	if( gStats ) gStats->Request();
+}
+
+void checkpoint_handler(int)
+{
+	if( gCheckpointNow ) *gCheckpointNow = 1;
 }
 
 template<typename State>
@@ -44,32 +61,167 @@ State GetRandomInitialState( State state, int max = 50  )
 int main( int argc, char** argv )
 {
 
+	//A JSON line of search statistics every second, and on SIGUSR1, in a file of their
+	//own so they don't interleave with the solvers' reports on stderr
+	const char * StatsFile = "search-stats.jsonl";
+	std::unique_ptr< FILE, int(*)( FILE* ) > StatsOut( fopen( StatsFile, "w" ), fclose );
+	SearchStats Stats;
+	if( StatsOut ) Stats.Start( StatsOut.get(), 1.0 );
+	else std::cerr << "Couldn't open " << StatsFile << ", no live statistics" << std::endl;
+	gStats = &Stats;
+
 	std::signal( SIGUSR1, signal_handler );
+	std::signal( SIGUSR2, checkpoint_handler );
 
 	typedef SlidingPuzzleState<5,5> State_t;
 
+	//Build the pattern database once with 'pdb-build', later runs pick it up if it's there
+	State_t::PatternDB PDB;
+	const char * PDBFile = "sliding-puzzle-5x5.pdb";
+	if( argc > 1 && strcmp( argv[1], "pdb-build" ) == 0 )
+	{
+		PDB.Build();
+		if( !PDB.Save( PDBFile ) )
+		{
+			std::cerr << "Couldn't write " << PDBFile << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	if( PDB.Load( PDBFile ) )
+	{
+		State_t::PDB = &PDB;
+		std::cerr << "Using pattern database " << PDBFile << std::endl;
+	}
+
 	auto initial = GetRandomInitialState( State_t(), 100 );
 
 	//Solve that puzzle
 	bool idast = ( argc > 1 && strcmp( argv[1], "idastar" ) == 0 );
+	bool idastt= ( argc > 1 && strcmp( argv[1], "idastar-tt" ) == 0 );
 	bool rbfs  = ( argc > 1 && strcmp( argv[1], "rbfs"    ) == 0 );
+	bool hdast = ( argc > 1 && strcmp( argv[1], "hdastar" ) == 0 );
+	bool pidast= ( argc > 1 && strcmp( argv[1], "pidastar") == 0 );
+	bool inplace=( argc > 1 && strcmp( argv[1], "idastar-inplace") == 0 );
+	bool bidir = ( argc > 1 && strcmp( argv[1], "bidirectional") == 0 );
+	bool extast= ( argc > 1 && strcmp( argv[1], "external-astar") == 0 );
+	bool smast = ( argc > 1 && strcmp( argv[1], "smastar") == 0 );
+	bool anyast= ( argc > 1 && strcmp( argv[1], "anytime") == 0 );
+	bool compact=( argc > 1 && strcmp( argv[1], "astar-compact") == 0 );
 	std::vector< State_t::Action > Solution;
 	if( idast )
 	{
 		auto Solver = IDAStar<State_t >{};
-		gPrintStatus = &Solver.PrintStatus;
+		Solver.Stats = &Stats;
+		gCheckpointNow = &Solver.CheckpointNow;
+		Solver.CheckpointFile = "idastar.ckpt";
+		Solution = Solver.Solve( initial );
+	}
+	else if( idastt )
+	{
+		auto Solver = IDAStar<State_t >{};
+		Solver.Stats = &Stats;
+		Solver.TranspositionBytes = std::size_t(1) << 30;
+		Solution = Solver.Solve( initial );
+
+		std::cerr << " Table MB: "     << Solver.Table.bytes() / 1e6
+		          << " Probes: "       << Solver.Table.NumProbes
+		          << " Hits: "         << Solver.Table.NumHits
+		          << " Cutoffs: "      << Solver.NumTableCutoffs
+		          << " Stores: "       << Solver.Table.NumStores
+		          << " Replacements: " << Solver.Table.NumReplacements
+		          << std::endl;
+	}
+	else if( inplace )
+	{
+		auto Solver = IDAStarInPlace<State_t>{};
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+	}
+	else if( pidast )
+	{
+		auto Solver = PIDAStar<State_t>{};
+		Solver.Stats = &Stats;
 		Solution = Solver.Solve( initial );
 	}
 	else if( rbfs ) 
 	{
 		auto Solver = RBFS<State_t>{};
-		gPrintStatus = &Solver.PrintStatus;
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+	}
+	else if( bidir )
+	{
+		auto Solver = Bidirectional<State_t>{};
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+	}
+	else if( anyast )
+	{
+		auto Solver = AnytimeAStar<State_t>{};
+		Solver.Stats = &Stats;
+		Solver.OnSolution = [&]( const std::vector< State_t::Action > & path, double bound )
+		{
+			std::cerr << " Solution: " << path.size() << " Bound: " << bound << " Weight: " << Solver.Weight << std::endl;
+		};
+		Solution = Solver.Solve( initial );
+	}
+	else if( smast )
+	{
+		auto Solver = SMAStar<State_t>{};
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+	}
+	else if( extast )
+	{
+		auto Solver = ExternalAStar<State_t>{};
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+
+		std::cerr << " Expanded: "      << Solver.NumExpanded
+		          << " Runs: "          << Solver.NumRuns
+		          << " MB written: "    << Solver.BytesWritten / 1e6
+		          << " MB read: "       << Solver.BytesRead / 1e6
+		          << " I/O MB/s: "      << ( Solver.BytesWritten + Solver.BytesRead ) / 1e6 / Solver.IOSeconds
+		          << " Time: "          << Solver.WallSeconds
+		          << std::endl;
+	}
+	else if( hdast )
+	{
+		HDAStar<State_t> Solver;
+		Solver.Stats = &Stats;
+		Solution = Solver.Solve( initial );
+
+		//Rerun serially on the same instance to see what the threads bought us
+		auto Serial = AStar<State_t>{};
+		Serial.Stats = &Stats;
+		auto start = std::chrono::steady_clock::now();
+		Serial.Solve( initial );
+		double serial_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+		std::cerr << " Threads: "         << Solver.NumThreads
+		          << " Parallel time: "   << Solver.WallSeconds
+		          << " Serial time: "     << serial_seconds
+		          << " Speedup: "         << serial_seconds / Solver.WallSeconds
+		          << " Search overhead: " << double( Solver.NumExpanded ) / Serial.NumExpanded - 1.
+		          << " Load balance: "    << double( Solver.MaxThreadExpanded ) * Solver.NumThreads / Solver.NumExpanded
+		          << std::endl;
+	}
+	else if( compact )
+	{
+		auto Solver = AStar<State_t, true>{};
+		Solver.Stats = &Stats;
+		gCheckpointNow = &Solver.CheckpointNow;
+		Solver.CheckpointFile = "astar.ckpt";
 		Solution = Solver.Solve( initial );
+		std::cerr << " Nodes: " << Solver.NumNodes << " Bytes/node: " << double( Solver.NumBytes ) / Solver.NumNodes << std::endl;
 	}
 	else
 	{
 		auto Solver = AStar<State_t>{};
-		gPrintStatus = &Solver.PrintStatus;
+		Solver.Stats = &Stats;
+		gCheckpointNow = &Solver.CheckpointNow;
+		Solver.CheckpointFile = "astar.ckpt";
 		Solution = Solver.Solve( initial );
 	}
 
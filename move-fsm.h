@@ -0,0 +1,209 @@
+#pragma once
+#ifndef MOVE_FSM_H
+#define MOVE_FSM_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+//Duplicate pruning with a finite state machine (Taylor & Korf 1993)
+//
+//A move string is a duplicate if some other string has the same effect from every
+//state the first can be applied in, and is cheaper or, at equal cost, lexicographically
+//smaller. Any path containing a duplicate can be swapped for a better one, so the best
+//path to every state contains none, and a depth first search can skip every path that
+//does. The duplicates are found offline and compiled into an Aho-Corasick automaton
+//over action indices: each search frame carries an automaton state, and a move whose
+//transition lands on a duplicate is never generated.
+template< std::size_t Alphabet >
+struct MoveFSM
+{
+	typedef int32_t Node;
+	constexpr static Node Start = 0;
+	constexpr static Node Pruned = -1; //transition that completes a duplicate
+
+	std::vector< std::array< Node, Alphabet > > next;
+	std::size_t NumStrings = 0; //duplicates compiled in
+
+	Node Next( Node node, std::size_t action ) const { return next[ node ][ action ]; }
+	std::size_t size() const { return next.size(); }
+
+	//Compile strings (of action indices below Alphabet) into an automaton that
+	//rejects any move completing one of them
+	static MoveFSM Build( const std::vector< std::string > & strings )
+	{
+		MoveFSM fsm;
+		fsm.NumStrings = strings.size();
+
+		//Trie
+		std::vector< std::array< Node, Alphabet > > trie( 1 );
+		std::vector< bool > terminal( 1, false );
+		trie[0].fill( Pruned );
+		for( auto & s : strings )
+		{
+			Node node = Start;
+			for( char c : s )
+			{
+				if( trie[ node ][ std::size_t( c ) ] == Pruned )
+				{
+					trie[ node ][ std::size_t( c ) ] = Node( trie.size() );
+					trie.emplace_back();
+					trie.back().fill( Pruned );
+					terminal.push_back( false );
+				}
+				node = trie[ node ][ std::size_t( c ) ];
+			}
+			terminal[ node ] = true;
+		}
+
+		//Failure links breadth first, filling in every missing edge on the way
+		std::vector< Node > fail( trie.size(), Start );
+		std::deque< Node > queue;
+		for( std::size_t a = 0; a < Alphabet; ++a )
+		{
+			Node child = trie[ Start ][a];
+			if( child == Pruned ) trie[ Start ][a] = Start;
+			else                  queue.push_back( child );
+		}
+		while( !queue.empty() )
+		{
+			Node node = queue.front();
+			queue.pop_front();
+			if( terminal[ fail[ node ] ] ) terminal[ node ] = true; //ends with a duplicate
+			for( std::size_t a = 0; a < Alphabet; ++a )
+			{
+				Node child = trie[ node ][a];
+				if( child == Pruned )
+					trie[ node ][a] = trie[ fail[ node ] ][a];
+				else
+				{
+					fail[ child ] = trie[ fail[ node ] ][a];
+					queue.push_back( child );
+				}
+			}
+		}
+
+		//Terminal nodes are never entered, so drop them and renumber the rest
+		std::vector< Node > id( trie.size(), Pruned );
+		for( std::size_t i = 0; i < trie.size(); ++i )
+			if( !terminal[i] ) { id[i] = Node( fsm.next.size() ); fsm.next.emplace_back(); }
+		for( std::size_t i = 0; i < trie.size(); ++i )
+		{
+			if( terminal[i] ) continue;
+			for( std::size_t a = 0; a < Alphabet; ++a )
+				fsm.next[ id[i] ][a] = id[ trie[i][a] ];
+		}
+		return fsm;
+	}
+};
+
+template< std::size_t Alphabet > constexpr typename MoveFSM< Alphabet >::Node MoveFSM< Alphabet >::Start;
+template< std::size_t Alphabet > constexpr typename MoveFSM< Alphabet >::Node MoveFSM< Alphabet >::Pruned;
+
+//Duplicate strings of up to max_length unit cost moves of a blank on a grid, where
+//move a shifts the blank by moves[a] (row, column) and swaps it with the tile there.
+//
+//Strings are enumerated breadth first in lexicographic order on an unbounded grid, so
+//the first string to reach an arrangement is the best one. A later string is only a
+//duplicate if that better one stays within the cells it visits: then it fits on any
+//board the later one does. Strings with a duplicate inside them are never extended.
+inline std::vector< std::string > GridDuplicateStrings( const std::vector< std::pair< int, int > > & moves, unsigned max_length )
+{
+	const int Side = 2 * int( max_length ) + 1;
+	const int Center = int( max_length ) * Side + int( max_length );
+
+	struct Path
+	{
+		std::string moves;
+		int         blank;
+		std::vector< std::pair< int16_t, int16_t > > tiles;     //(cell, tile) for tiles away from home, sorted by cell
+		std::vector< int16_t >                       footprint; //cells the blank visited, sorted
+	};
+
+	auto key = []( const Path & p )
+	{
+		std::string k( reinterpret_cast< const char* >( &p.blank ), sizeof( p.blank ) );
+		k.append( reinterpret_cast< const char* >( p.tiles.data() ), p.tiles.size() * sizeof( p.tiles[0] ) );
+		return k;
+	};
+
+	std::vector< std::string > duplicates;
+	std::unordered_set< std::string > duplicate_set;
+	std::unordered_map< std::string, std::vector< std::vector< int16_t > > > seen; //arrangement -> footprints of kept paths
+
+	std::vector< Path > level( 1 );
+	level[0].blank     = Center;
+	level[0].footprint = { int16_t( Center ) };
+	seen[ key( level[0] ) ].push_back( level[0].footprint );
+
+	for( unsigned length = 1; length <= max_length; ++length )
+	{
+		std::vector< Path > next;
+		for( auto & p : level )
+		{
+			for( std::size_t a = 0; a < moves.size(); ++a )
+			{
+				Path c;
+				c.moves = p.moves + char( a );
+
+				//Already ruled out by a shorter duplicate at its end
+				bool contains = false;
+				for( std::size_t start = 1; start < c.moves.size() && !contains; ++start )
+					contains = duplicate_set.count( c.moves.substr( start ) ) != 0;
+				if( contains ) continue;
+
+				int r = p.blank / Side + moves[a].first, col = p.blank % Side + moves[a].second;
+				c.blank = r * Side + col;
+
+				//The tile at the blank's new cell slides into its old one
+				c.tiles = p.tiles;
+				auto at = [&]( int cell ) { return std::lower_bound( c.tiles.begin(), c.tiles.end(), std::make_pair( int16_t( cell ), int16_t( -1 ) ) ); };
+				int16_t tile = int16_t( c.blank );
+				auto it = at( c.blank );
+				if( it != c.tiles.end() && it->first == c.blank ) { tile = it->second; c.tiles.erase( it ); }
+				if( tile != p.blank ) c.tiles.insert( at( p.blank ), std::make_pair( int16_t( p.blank ), tile ) );
+
+				c.footprint = p.footprint;
+				auto f = std::lower_bound( c.footprint.begin(), c.footprint.end(), int16_t( c.blank ) );
+				if( f == c.footprint.end() || *f != c.blank ) c.footprint.insert( f, int16_t( c.blank ) );
+
+				auto & kept = seen[ key( c ) ];
+				bool duplicate = std::any_of( kept.begin(), kept.end(), [&]( const std::vector< int16_t > & fp )
+				{
+					return std::includes( c.footprint.begin(), c.footprint.end(), fp.begin(), fp.end() );
+				} );
+				if( duplicate )
+				{
+					duplicates.push_back( c.moves );
+					duplicate_set.insert( c.moves );
+					continue;
+				}
+				kept.push_back( c.footprint );
+				next.push_back( std::move( c ) );
+			}
+		}
+		level.swap( next );
+	}
+	return duplicates;
+}
+
+//How IDA* style searches prune duplicate paths: Filter() drops the actions a node's
+//automaton state rules out, and Next() is the state to hand a child. States with an
+//automaton specialize this; by default nothing beyond AvailableActions is pruned.
+template< typename State >
+struct DuplicatePruner
+{
+	typedef typename State::Action Action;
+	typedef int32_t Node;
+
+	static Node Start() { return 0; }
+	static void Filter( Node, typename Action::Actions & ) {}
+	static Node Next( Node node, const Action & ) { return node; }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef MOVE_TABLE_H
+#define MOVE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//Blank moves on an N by M board, worked out at compile time so generating and
+//applying a move is a few lookups instead of bounds checks, a switch, and divisions.
+//
+//Directions are the hole's: 0 up, 1 down, 2 left, 3 right, and 4 for none. Moves
+//come in that order, less the ones off the board and the one undoing the previous
+//move, packed to the front and padded with None.
+template< unsigned N, unsigned M >
+struct SlidingMoveTable
+{
+	constexpr static unsigned Cells = N * M;
+	constexpr static unsigned Dirs  = 4;
+	constexpr static unsigned None  = Dirs;
+
+	int8_t  offset[ Dirs + 1 ];               //change in the hole's cell
+	uint8_t row[ Cells ], col[ Cells ];
+	uint8_t moves[ Cells ][ Dirs + 1 ][ Dirs ]; //by hole cell and previous direction
+	uint8_t num_moves[ Cells ][ Dirs + 1 ];
+
+	//Change in tile's Manhattan distance when the hole at cell moves in dir, sliding
+	//tile the other way into cell. 0 for the hole itself and for moves off the board.
+	int8_t  delta[ Cells ][ Cells ][ Dirs + 1 ];
+
+	constexpr SlidingMoveTable() : offset{}, row{}, col{}, moves{}, num_moves{}, delta{}
+	{
+		const int dr[ Dirs + 1 ] = { -1, 1,  0, 0, 0 };
+		const int dc[ Dirs + 1 ] = {  0, 0, -1, 1, 0 };
+		for( unsigned d = 0; d <= Dirs; ++d )
+			offset[d] = int8_t( dr[d] * int( M ) + dc[d] );
+
+		for( unsigned cell = 0; cell < Cells; ++cell )
+		{
+			row[ cell ] = uint8_t( cell / M );
+			col[ cell ] = uint8_t( cell % M );
+		}
+
+		for( unsigned cell = 0; cell < Cells; ++cell )
+		{
+			int r = int( cell / M ), c = int( cell % M );
+			for( unsigned prev = 0; prev <= Dirs; ++prev )
+			{
+				unsigned count = 0;
+				for( unsigned d = 0; d < Dirs; ++d )
+				{
+					bool on_board = r + dr[d] >= 0 && r + dr[d] < int( N ) && c + dc[d] >= 0 && c + dc[d] < int( M );
+					bool undoes   = prev != None && ( d ^ 1 ) == prev;
+					if( on_board && !undoes ) moves[ cell ][ prev ][ count++ ] = uint8_t( d );
+				}
+				num_moves[ cell ][ prev ] = uint8_t( count );
+				for( unsigned i = count; i < Dirs; ++i ) moves[ cell ][ prev ][i] = uint8_t( None );
+			}
+
+			for( unsigned d = 0; d < Dirs; ++d )
+			{
+				int fr = r + dr[d], fc = c + dc[d];
+				if( fr < 0 || fr >= int( N ) || fc < 0 || fc >= int( M ) ) continue;
+				for( unsigned tile = 1; tile < Cells; ++tile )
+				{
+					int tr = int( tile / M ), tc = int( tile % M );
+					int before = ( tr > fr ? tr - fr : fr - tr ) + ( tc > fc ? tc - fc : fc - tc );
+					int after  = ( tr > r  ? tr - r  : r  - tr ) + ( tc > c  ? tc - c  : c  - tc );
+					delta[ tile ][ cell ][d] = int8_t( after - before );
+				}
+			}
+		}
+	}
+};
+
+template< unsigned N, unsigned M >
+constexpr SlidingMoveTable< N, M > SlidingMoves = SlidingMoveTable< N, M >();
+
+#endif
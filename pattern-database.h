@@ -0,0 +1,365 @@
+#pragma once
+#ifndef PATTERN_DATABASE_H
+#define PATTERN_DATABASE_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Additive disjoint pattern databases for the N x M sliding puzzle.
+//
+//The tiles (not the hole) are split into disjoint patterns. For each pattern, a
+//table holds the fewest moves *of that pattern's tiles* needed to get them home
+//from any placement, so the sum over the patterns is admissible. Tables are
+//indexed by the rank of the pattern tiles' cells as a partial permutation.
+//
+//Tables are built by a backward breadth first search from the goal over
+//(pattern placement, hole cell). Moving the hole through non-pattern cells is
+//free, so each placement keeps a bitmask of hole cells and those free moves are
+//a flood fill on the mask. Built tables are saved to a flat file that Load() maps
+//straight back in.
+template< unsigned N, unsigned M >
+struct PatternDatabase
+{
+	constexpr static unsigned NumCells = N * M;
+	static_assert( NumCells <= 32, "hole cells are tracked in a 32 bit mask" );
+
+	typedef std::vector< std::vector< unsigned char > > Partition; //tiles of each pattern
+
+	struct Pattern
+	{
+		std::vector< unsigned char > tiles;
+		const unsigned char *        table = nullptr;
+		uint64_t                     size  = 0;
+	};
+
+	std::vector< Pattern > patterns;
+	unsigned char pattern_of[ NumCells ]; //pattern holding each tile, NoPattern for the hole
+	unsigned char slot_of   [ NumCells ]; //index of each tile within its pattern
+	constexpr static unsigned char NoPattern = 0xFF;
+
+	PatternDatabase() { std::memset( pattern_of, NoPattern, sizeof( pattern_of ) ); }
+	~PatternDatabase() { Unmap(); }
+
+	PatternDatabase( const PatternDatabase & ) = delete;
+	PatternDatabase & operator=( const PatternDatabase & ) = delete;
+
+	//7-8 for the 15-puzzle and 6-6-6-6 for the 24-puzzle (Korf & Felner),
+	//otherwise runs of at most 6 consecutive tiles
+	static Partition DefaultPartition()
+	{
+		if( N == 4 && M == 4 )
+			return { { 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } };
+		if( N == 5 && M == 5 )
+			return { {  1,  2,  5,  6,  7, 12 }, {  3,  4,  8,  9, 13, 14 },
+			         { 10, 11, 15, 16, 20, 21 }, { 17, 18, 19, 22, 23, 24 } };
+		Partition p;
+		for( unsigned t = 1; t < NumCells; ++t )
+		{
+			if( p.empty() || p.back().size() == 6 ) p.emplace_back();
+			p.back().push_back( (unsigned char)t );
+		}
+		return p;
+	}
+
+	//Ranking of k distinct cells (a partial permutation of NumCells)
+	static uint64_t TableSize( unsigned k )
+	{
+		uint64_t size = 1;
+		for( unsigned i = 0; i < k; ++i ) size *= NumCells - i;
+		return size;
+	}
+
+	static uint64_t Rank( const unsigned char * pos, unsigned k )
+	{
+		uint64_t rank = 0;
+		uint32_t used = 0;
+		for( unsigned i = 0; i < k; ++i )
+		{
+			unsigned d = pos[i] - __builtin_popcount( used & ( ( 1u << pos[i] ) - 1 ) );
+			rank = rank * ( NumCells - i ) + d;
+			used |= 1u << pos[i];
+		}
+		return rank;
+	}
+
+	static void Unrank( uint64_t rank, unsigned k, unsigned char * pos )
+	{
+		unsigned char d[ NumCells ];
+		for( unsigned i = k; i-- > 0; )
+		{
+			d[i]  = (unsigned char)( rank % ( NumCells - i ) );
+			rank /= NumCells - i;
+		}
+		uint32_t used = 0;
+		for( unsigned i = 0; i < k; ++i )
+		{
+			//d[i]'th free cell
+			uint32_t free = ~used;
+			for( unsigned j = 0; j < d[i]; ++j ) free &= free - 1;
+			pos[i] = (unsigned char)__builtin_ctz( free );
+			used |= 1u << pos[i];
+		}
+	}
+
+	//Value of pattern p with its tiles at pos (in pattern tile order)
+	int Lookup( unsigned p, const unsigned char * pos ) const
+	{
+		return patterns[p].table[ Rank( pos, unsigned( patterns[p].tiles.size() ) ) ];
+	}
+
+	//Sum over all patterns, given the cell of every tile
+	int Evaluate( const unsigned char * cell_of_tile ) const
+	{
+		int h = 0;
+		unsigned char pos[ NumCells ];
+		for( unsigned p = 0; p < patterns.size(); ++p )
+		{
+			auto & tiles = patterns[p].tiles;
+			for( unsigned i = 0; i < tiles.size(); ++i ) pos[i] = cell_of_tile[ tiles[i] ];
+			h += Lookup( p, pos );
+		}
+		return h;
+	}
+
+	//Identifies the partition, which fixes every table, e.g. for telling checkpoints
+	//made under different databases apart (FNV-1a over the patterns' tiles)
+	uint64_t Id() const
+	{
+		uint64_t id = 14695981039346656037ull;
+		auto mix = [&]( unsigned char byte ){ id = ( id ^ byte ) * 1099511628211ull; };
+		for( auto & p : patterns )
+		{
+			mix( (unsigned char)p.tiles.size() );
+			for( unsigned char tile : p.tiles ) mix( tile );
+		}
+		return id;
+	}
+
+	void Build( const Partition & partition = DefaultPartition(), unsigned threads = std::thread::hardware_concurrency() )
+	{
+		Unmap();
+		patterns.clear();
+		built.clear();
+		std::memset( pattern_of, NoPattern, sizeof( pattern_of ) );
+
+		for( auto & tiles : partition )
+		{
+			built.emplace_back();
+			BuildPattern( tiles, built.back(), std::max( 1u, threads ) );
+			AddPattern( tiles, built.back().data() );
+		}
+	}
+
+	//File layout: Header, then one PatternRecord per pattern, then the byte tables at page aligned offsets
+	struct Header
+	{
+		char     magic[8];
+		uint32_t n, m, num_patterns, reserved;
+	};
+	struct PatternRecord
+	{
+		uint32_t      k;
+		unsigned char tiles[ 32 ];
+		uint64_t      offset;
+		uint64_t      size;
+	};
+	constexpr static uint64_t Alignment = 4096;
+
+	bool Save( const char * path ) const
+	{
+		FILE * f = fopen( path, "wb" );
+		if( !f ) return false;
+
+		Header header{ { 'S', 'P', 'D', 'B', 0, 0, 0, 1 }, N, M, uint32_t( patterns.size() ), 0 };
+		bool ok = fwrite( &header, sizeof( header ), 1, f ) == 1;
+
+		uint64_t offset = Align( sizeof( Header ) + patterns.size() * sizeof( PatternRecord ) );
+		for( auto & p : patterns )
+		{
+			PatternRecord rec{};
+			rec.k      = uint32_t( p.tiles.size() );
+			std::copy( p.tiles.begin(), p.tiles.end(), rec.tiles );
+			rec.offset = offset;
+			rec.size   = p.size;
+			ok = ok && fwrite( &rec, sizeof( rec ), 1, f ) == 1;
+			offset = Align( offset + p.size );
+		}
+		for( auto & p : patterns )
+		{
+			ok = ok && fseek( f, long( Align( ftell( f ) ) ), SEEK_SET ) == 0;
+			ok = ok && fwrite( p.table, 1, p.size, f ) == p.size;
+		}
+		return fclose( f ) == 0 && ok;
+	}
+
+	bool Load( const char * path )
+	{
+		int fd = open( path, O_RDONLY );
+		if( fd < 0 ) return false;
+
+		struct stat st;
+		void * p = MAP_FAILED;
+		if( fstat( fd, &st ) == 0 && std::size_t( st.st_size ) >= sizeof( Header ) )
+			p = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( p == MAP_FAILED ) return false;
+
+		Unmap();
+		patterns.clear();
+		built.clear();
+		std::memset( pattern_of, NoPattern, sizeof( pattern_of ) );
+		mapped      = p;
+		mapped_size = std::size_t( st.st_size );
+
+		const unsigned char * base = static_cast< const unsigned char* >( p );
+		const Header & header = *reinterpret_cast< const Header* >( base );
+		bool ok = std::memcmp( header.magic, "SPDB\0\0\0\1", 8 ) == 0 && header.n == N && header.m == M &&
+		          sizeof( Header ) + header.num_patterns * sizeof( PatternRecord ) <= mapped_size;
+
+		const PatternRecord * recs = reinterpret_cast< const PatternRecord* >( base + sizeof( Header ) );
+		for( uint32_t i = 0; ok && i < header.num_patterns; ++i )
+		{
+			const PatternRecord & rec = recs[i];
+			ok = rec.k <= NumCells && rec.size == TableSize( rec.k ) && rec.offset + rec.size <= mapped_size;
+			if( ok ) AddPattern( std::vector< unsigned char >( rec.tiles, rec.tiles + rec.k ), base + rec.offset );
+		}
+
+		if( !ok )
+		{
+			Unmap();
+			patterns.clear();
+			std::memset( pattern_of, NoPattern, sizeof( pattern_of ) );
+		}
+		return ok;
+	}
+
+	private:
+	std::vector< std::vector< unsigned char > > built; //tables from Build(), when not mapped
+	void *      mapped      = nullptr;
+	std::size_t mapped_size = 0;
+
+	static uint64_t Align( uint64_t x ) { return ( x + Alignment - 1 ) & ~( Alignment - 1 ); }
+
+	void Unmap()
+	{
+		if( mapped ) munmap( mapped, mapped_size );
+		mapped = nullptr;
+		mapped_size = 0;
+	}
+
+	void AddPattern( const std::vector< unsigned char > & tiles, const unsigned char * table )
+	{
+		Pattern p;
+		p.tiles = tiles;
+		p.table = table;
+		p.size  = TableSize( unsigned( tiles.size() ) );
+		for( unsigned i = 0; i < tiles.size(); ++i )
+		{
+			pattern_of[ tiles[i] ] = (unsigned char)patterns.size();
+			slot_of   [ tiles[i] ] = (unsigned char)i;
+		}
+		patterns.push_back( p );
+	}
+
+	//Cells the hole can step to from any cell in mask
+	static uint32_t Neighbors( uint32_t mask )
+	{
+		uint32_t firstCol = 0, lastCol = 0;
+		for( unsigned n = 0; n < N; ++n )
+		{
+			firstCol |= 1u << ( n * M );
+			lastCol  |= 1u << ( n * M + M - 1 );
+		}
+		uint32_t all = uint32_t( ( uint64_t(1) << NumCells ) - 1 );
+		return ( ( mask >> M ) | ( mask << M ) | ( ( mask & ~firstCol ) >> 1 ) | ( ( mask & ~lastCol ) << 1 ) ) & all;
+	}
+
+	static void BuildPattern( const std::vector< unsigned char > & tiles, std::vector< unsigned char > & table, unsigned threads )
+	{
+		unsigned k    = unsigned( tiles.size() );
+		uint64_t size = TableSize( k );
+		table.assign( size, 0xFF );
+
+		//Hole cells per placement: reached so far, at this depth, and at the next
+		std::vector< uint32_t > visited( size, 0 ), cur( size, 0 ), next( size, 0 );
+
+		unsigned char goal[ NumCells ];
+		for( unsigned i = 0; i < k; ++i ) goal[i] = tiles[i]; //tile t belongs in cell t
+		uint64_t start = Rank( goal, k );
+		visited[ start ] = cur[ start ] = 1u; //hole home in cell 0
+
+		for( int depth = 0; ; ++depth )
+		{
+			std::atomic< bool > any( false );
+			auto expand = [&]( uint64_t begin, uint64_t end )
+			{
+				unsigned char pos[ NumCells ];
+				bool found = false;
+				for( uint64_t idx = begin; idx < end; ++idx )
+				{
+					if( !cur[idx] ) continue;
+					found = true;
+
+					Unrank( idx, k, pos );
+					uint32_t occupied = 0;
+					for( unsigned i = 0; i < k; ++i ) occupied |= 1u << pos[i];
+
+					//Free moves: flood the hole through cells without pattern tiles
+					uint32_t reach = cur[idx], frontier = reach;
+					while( ( frontier = Neighbors( frontier ) & ~occupied & ~visited[idx] & ~reach ) )
+						reach |= frontier;
+					visited[idx] |= reach;
+					if( table[idx] == 0xFF ) table[idx] = (unsigned char)depth;
+
+					//Moves of a pattern tile into a neighboring hole cost 1
+					for( unsigned i = 0; i < k; ++i )
+					{
+						unsigned char cell = pos[i];
+						for( uint32_t holes = reach & Neighbors( 1u << cell ); holes; holes &= holes - 1 )
+						{
+							pos[i] = (unsigned char)__builtin_ctz( holes );
+							__atomic_fetch_or( &next[ Rank( pos, k ) ], 1u << cell, __ATOMIC_RELAXED );
+						}
+						pos[i] = cell;
+					}
+				}
+				if( found ) any = true;
+			};
+			Parallel( size, threads, expand );
+			if( !any ) break;
+
+			//Drop anything reached for free this round, the rest is the next layer
+			Parallel( size, threads, [&]( uint64_t begin, uint64_t end )
+			{
+				for( uint64_t idx = begin; idx < end; ++idx )
+				{
+					cur[idx]      = next[idx] & ~visited[idx];
+					visited[idx] |= cur[idx];
+					next[idx]     = 0;
+				}
+			});
+		}
+	}
+
+	template< typename F >
+	static void Parallel( uint64_t size, unsigned threads, F && f )
+	{
+		std::vector< std::thread > pool;
+		uint64_t chunk = ( size + threads - 1 ) / threads;
+		for( unsigned t = 1; t < threads; ++t )
+			pool.emplace_back( [&, t]{ f( std::min( size, t * chunk ), std::min( size, ( t + 1 ) * chunk ) ); } );
+		f( 0, std::min( size, chunk ) );
+		for( auto & thread : pool ) thread.join();
+	}
+};
+
+#endif
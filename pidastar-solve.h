@@ -0,0 +1,215 @@
+#pragma once
+#ifndef PIDASTAR_SOLVE_H
+#define PIDASTAR_SOLVE_H
+
+#include <vector>
+#include <deque>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <iostream>
+
+#include "idastar-solve.h"
+#include "search-stats.h"
+
+//Parallel IDA*
+//
+//The top of the tree is expanded breadth first until there are plenty of subtrees
+//per thread. Each iteration deals the subtrees out to per-thread deques: threads
+//work from the front of their own and idle threads steal from the back of others'.
+//Subtrees are searched with IDAStar::Search, the smallest pruned f is merged into
+//a shared next limit, and the first goal found stops every thread.
+template< typename State >
+struct PIDAStar
+{
+	SearchStats * Stats = nullptr; //sampled by thread 0 after each work item when set
+
+	unsigned    NumThreads     = std::max( 1u, std::thread::hardware_concurrency() );
+	std::size_t ItemsPerThread = 64; //split the tree until there are this many subtrees per thread
+	int         MaxSplitDepth  = 32;
+
+	std::size_t NumWorkItems   = 0;
+	std::size_t NumSteals      = 0;
+	std::size_t NumExpanded    = 0; //by the subtree searches, summed over threads
+	std::size_t NumGenerated   = 0;
+
+	typedef typename State::Action Action;
+	typedef typename IDAStar< State >::Pruner     Pruner;
+	typedef typename IDAStar< State >::PrunerNode PrunerNode;
+
+	struct WorkItem
+	{
+		State      state;
+		Action     prevAction;
+		int        g;
+		PrunerNode node;   //duplicate pruning automaton state, where the subtree search starts
+		std::vector< Action > prefix;  //actions from the initial state
+		std::vector< int >    prefix_f;//f of each node along prefix, ending with this one
+	};
+
+	struct WorkQueue
+	{
+		std::mutex                mutex;
+		std::deque< std::size_t > items;
+	};
+
+	std::vector< WorkItem > Items;
+
+	void Split( const State & initial )
+	{
+		Items.clear();
+		std::vector< WorkItem > layer { WorkItem{ initial, Action(), 0, Pruner::Start(), {}, { initial.EstGoalDist() } } };
+		std::size_t target = ItemsPerThread * std::max( 1u, NumThreads );
+
+		for( int depth = 0; depth < MaxSplitDepth && !layer.empty() && layer.size() < target; ++depth )
+		{
+			std::vector< WorkItem > next;
+			for( auto & item : layer )
+			{
+				//Goals stay leaves, so every goal in the tree is an item or below one
+				if( item.state.IsGoal() )
+				{
+					Items.push_back( std::move( item ) );
+					continue;
+				}
+				//Filtered as IDA* would, so the split drops the same duplicate paths
+				auto actions = item.state.AvailableActions( item.prevAction );
+				Pruner::Filter( item.node, actions );
+				for( auto & paction : actions )
+				{
+					if( !paction ) continue;
+					WorkItem child{ item.state.Apply( *paction ), *paction, item.g + paction->GetCost(),
+					                Pruner::Next( item.node, *paction ), item.prefix, item.prefix_f };
+					child.prefix.push_back( *paction );
+					child.prefix_f.push_back( child.g + child.state.EstGoalDist() );
+					next.push_back( std::move( child ) );
+				}
+			}
+			layer.swap( next );
+		}
+		for( auto & item : layer )
+			Items.push_back( std::move( item ) );
+
+		NumWorkItems = Items.size();
+	}
+
+	static void LowerTo( std::atomic< int > & a, int v )
+	{
+		int cur = a.load();
+		while( v < cur && !a.compare_exchange_weak( cur, v ) );
+	}
+
+	//One IDA* iteration at limit over all work items. Returns true with the solution in ret.
+	bool Iterate( int limit, std::atomic< int > & next_limit, std::vector< Action > & ret )
+	{
+		unsigned threads = std::max( 1u, NumThreads );
+		std::vector< WorkQueue > queues( threads );
+		for( std::size_t i = 0; i < Items.size(); ++i )
+			queues[ i % threads ].items.push_back( i );
+
+		std::atomic< bool >        found( false );
+		std::atomic< std::size_t > steals( 0 );
+		std::atomic< std::size_t > expanded( 0 ), generated( 0 );
+		std::mutex                 found_mutex;
+
+		auto worker = [&]( unsigned t )
+		{
+			IDAStar< State > searcher;
+			std::vector< Action > path;
+			int local_next = std::numeric_limits<int>::max();
+
+			while( !found.load( std::memory_order_relaxed ) )
+			{
+				//Own work from the front, stolen work from the back
+				std::size_t index = Items.size();
+				for( unsigned k = 0; k < threads && index == Items.size(); ++k )
+				{
+					WorkQueue & q = queues[ ( t + k ) % threads ];
+					std::lock_guard< std::mutex > lock( q.mutex );
+					if( q.items.empty() ) continue;
+					if( k == 0 ) { index = q.items.front(); q.items.pop_front(); }
+					else         { index = q.items.back();  q.items.pop_back(); ++steals; }
+				}
+				if( index == Items.size() ) break;
+
+				WorkItem & item = Items[ index ];
+
+				//IDA* would have cut the path off at its first node over the limit
+				auto over = std::find_if( item.prefix_f.begin(), item.prefix_f.end(), [&]( int f ){ return f > limit; } );
+				if( over != item.prefix_f.end() )
+				{
+					local_next = std::min( local_next, *over );
+					continue;
+				}
+
+				bool goal = item.state.IsGoal();
+				if( goal ) path.clear();
+				if( goal || searcher.Search( item.state, item.prevAction, item.g, item.node, limit, local_next, path, &found ) )
+				{
+					std::lock_guard< std::mutex > lock( found_mutex );
+					if( !found.load() )
+					{
+						ret = item.prefix;
+						ret.insert( ret.end(), path.begin(), path.end() );
+						found.store( true );
+					}
+				}
+
+				if( t == 0 && Stats && Stats->Wanted() )
+				{
+					//Counts are thread 0's in this iteration, plus every thread's in earlier ones
+					Stats->Publish( [&]( SearchSample & s )
+					{
+						s.solver    = "pidastar";
+						s.thread    = 0;
+						s.expanded  = searcher.NumExpanded;
+						s.generated = searcher.NumGenerated;
+						s.f_bound   = limit;
+						s.values    = { { "item", double( index ) }, { "items", double( Items.size() ) },
+						                { "steals", double( NumSteals + steals.load() ) },
+						                { "earlier_expanded", double( NumExpanded ) }, { "earlier_generated", double( NumGenerated ) } };
+					} );
+				}
+			}
+			LowerTo( next_limit, local_next );
+			expanded  += searcher.NumExpanded;
+			generated += searcher.NumGenerated;
+		};
+
+		std::vector< std::thread > pool;
+		for( unsigned t = 1; t < threads; ++t )
+			pool.emplace_back( worker, t );
+		worker( 0 );
+		for( auto & thread : pool )
+			thread.join();
+
+		NumSteals    += steals.load();
+		NumExpanded  += expanded.load();
+		NumGenerated += generated.load();
+		return found.load();
+	}
+
+std::vector< Action > Solve( const State & initial )
+{
+	std::vector< Action > ret;
+	NumSteals = NumExpanded = NumGenerated = 0;
+	if( initial.IsGoal() ) return ret; //No actions to do
+
+	Split( initial );
+
+	int limit = initial.EstGoalDist();
+	while( limit != std::numeric_limits<int>::max() )
+	{
+		std::atomic< int > next_limit( std::numeric_limits<int>::max() );
+		if( Iterate( limit, next_limit, ret ) )
+			return ret;
+		limit = next_limit.load();
+	}
+
+	return std::vector< Action >{};
+}
+};
+
+#endif
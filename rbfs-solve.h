@@ -3,134 +3,228 @@
 #define RBFS_SOLVE_H
 
 #include <vector>
-#include <queue>
+#include <array>
 #include <limits>
 #include <algorithm>
-#include <stack>
-#include "cpp-sort/sort.h"
-
-template< typename State > 
+#include <iostream>
+#include "move-fsm.h"
+#include "expand.h"
+#include "transposition-table.h"
+#include "search-stats.h"
+
+//Recursive Best First Search (Korf 1993) over a single mutable state.
+//
+//Each frame on the stack is a node on the current path with the backed-up F value of
+//every child and the bound B it may search up to. The best child is descended into
+//with bound min( B, second best F ); when its subtree has nothing left at or under
+//that bound, its lowest F comes back up and replaces the child's value in the frame.
+//Only the best and second best children matter for that, so they're found with one
+//pass over the children instead of sorting them.
+//
+//A node's children are generated together with ExpandAll, so States with a batched
+//kernel compute their h values in one go; only their F values are kept. Descending
+//applies the best child's action to the state in place, and backing up undoes it. A node reached again inherits its F from the frame above (a child of a
+//node whose F was raised past its f starts at that F), so a subtree searched before
+//isn't searched again below the value it backed up.
+//
+//Needs State::ApplyInPlace and State::UndoInPlace on top of the IDAStar contract.
+//
+//With TranspositionBytes set, subtrees also leave their backed-up F in a lossy
+//TranspositionTable, keyed like IDAStar's: a child reached before at a lower g is
+//dropped, and one backed up before at the same g starts from that value.
+template< typename State >
 struct RBFS
 {
-	bool PrintStatus = false;
+	SearchStats * Stats = nullptr; //sampled every 1024 steps when set
 	typedef typename State::Action Action;
 
+	//Skip successors the state's duplicate pruning automaton rules out
+	bool PruneDuplicates = true;
+	typedef ::DuplicatePruner< State > Pruner;
+	typedef typename Pruner::Node      PrunerNode;
+
+	//Optional lossy table of backed-up F values, keyed like IDAStar's; 0 bytes for none
+	std::size_t        TranspositionBytes = 0;
+	TranspositionTable Table;
+	std::size_t        NumTableCutoffs    = 0; //children skipped or raised by the table
+	std::size_t        NumExpanded        = 0;
+	std::size_t        NumGenerated       = 0;
+
+	constexpr static int Infinity = std::numeric_limits<int>::max();
+
+	static uint64_t Key( const State & state, PrunerNode node )
+	{
+		return uint64_t( std::hash< State >()( state ) ) ^ uint64_t( node ) * 0x9E3779B97F4A7C15ull;
+	}
+
 	std::vector< Action > Solution;
 
-	struct StateAndMeta
+	struct Frame
 	{
-		Action action;
-		State state;
+		typename Action::Actions actions;         //packed to the front
+		std::array< int, Action::MaxBranch > F; //backed-up value of each child
+		int num;    //children
+		int best;   //index of the lowest F, -1 for none
+		int second; //index of the next lowest, -1 for none
 
 		int g;
 		int f;
-		int F;// = std::numeric_limits<int>::max();
+		int B;
+		PrunerNode node; //automaton state for the path to here
 
-		bool operator< ( const StateAndMeta & o ) const
+		int BestF()   const { return best   < 0 ? Infinity : F[ best ];   }
+		int SecondF() const { return second < 0 ? Infinity : F[ second ]; }
+
+		void Select()
 		{
-			return F < o.F; //cheapest first
+			best = second = -1;
+			for( int i = 0; i < num; ++i )
+			{
+				if( F[i] == Infinity ) continue;
+				if( best < 0 || F[i] < F[ best ] )
+				{
+					second = best;
+					best   = i;
+				}
+				else if( second < 0 || F[i] < F[ second ] )
+					second = i;
+			}
 		}
 	};
 
-	unsigned int counter = 0;
-	unsigned int depth = 0;
-
-	typedef std::array< StateAndMeta, Action::MaxBranch > Child_t;
+	std::vector< Frame > Stack;
+	Successors< State >  Children; //of the node being expanded
 
-	void InitChild( const StateAndMeta & n, Child_t & child )
+	//Fill in frame's children for state, which is reached via prevAction with backed-up value F
+	void Expand( Frame & frame, const State & state, const Action & prevAction, int F )
 	{
-		auto actions = n.state.AvailableActions( n.action );
-		auto i = std::begin( child );
-		for( auto & paction : actions )
+		++NumExpanded;
+		frame.actions = state.AvailableActions( prevAction );
+		if( PruneDuplicates ) Pruner::Filter( frame.node, frame.actions );
+
+		ExpandAll( state, frame.actions, Children );
+		NumGenerated += Children.size;
+
+		int num = int( Children.size );
+		for( int i = 0; i < num; ++i )
 		{
-			if( paction )
+			const Action & action = *Children.actions[i];
+			const State &  child  = Children.states[i];
+			int g = frame.g + action.GetCost();
+
+			int f = g + child.EstGoalDist();
+			int & childF = frame.F[i];
+			childF = frame.f < F ? std::max( F, f ) : f;
+
+			//Reached more cheaply before, or backed up before to more than its f
+			if( const auto * entry = Table.Probe( Key( child, PruneDuplicates ? Pruner::Next( frame.node, action ) : frame.node ) ) )
 			{
-				i->action = *paction;
-				i->g      = n.g + paction->GetCost();
-				i->state  = n.state.Apply( *paction );
-				i->f      = i->g + i->state.EstGoalDist();
-				if( n.f < n.F )
-					i->F  = std::max( n.F, i->f );
-				else
-					i->F  = i->f;
-				++i;
+				if( entry->g < g )
+				{
+					childF = Infinity;
+					++NumTableCutoffs;
+				}
+				else if( entry->g == g && entry->bound > childF )
+				{
+					childF = entry->bound;
+					++NumTableCutoffs;
+				}
 			}
 		}
-		while( i != std::end( child )) (i++)->F = std::numeric_limits<int>::max();
-	}
-
-	struct StackFrame
-	{
-		const StateAndMeta & n;
-		int B;
-		StackFrame( const StateAndMeta & _n, int _B ) : n( _n ), B( _B ) {}
-
-		Child_t child;
-	};
-
-	void InitStackFrame( StackFrame & frame )
-	{
-		InitChild( frame.n, frame.child );
+		frame.num = num;
+		frame.Select();
 	}
 
 std::vector< Action > Solve( const State & initial )
 {
+	Solution.clear();
+	NumTableCutoffs = NumExpanded = NumGenerated = 0;
 	if( initial.IsGoal() ) return Solution; //No actions to do
 
-	int f = initial.EstGoalDist();
-	StateAndMeta n{ Action{}, initial, 0/*g*/, f/*f*/, f/*F*/ };
+	Table.resize( TranspositionBytes );
 
-	std::vector< StackFrame> Stack;
-	Stack.reserve( 2*f );
+	State state = initial;
+	int f = state.EstGoalDist();
 
-	Stack.push_back( { n, f/*initial B*/ } );
-	InitStackFrame( Stack.back() );
+	Stack.clear();
+	Stack.reserve( 2*f );
+	Stack.emplace_back();
+	Stack[0].g    = 0;
+	Stack[0].f    = f;
+	Stack[0].B    = Infinity;
+	Stack[0].node = Pruner::Start();
+	Expand( Stack[0], state, Action{}, f );
+
+	std::size_t depth = 0;
+	unsigned int counter = 0;
 
 	while( true )
 	{
-		auto & frame = Stack.back();
-		cppsort::sort( frame.child );
+		Frame & frame = Stack[ depth ];
+		int F = frame.BestF();
 
-		auto & top = frame.child[0];
-
-		if( ++counter % 100 == 0 && PrintStatus )
+		if( ++counter % 1024 == 0 && Stats && Stats->Wanted() )
 		{
-			PrintStatus = false;
-			std::cerr << counter << " " << Stack.size() << " " << top.F << " " << frame.B << std::endl;
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				//The frontier is the children along the path not being descended into, by backed-up F
+				s.solver    = "rbfs";
+				s.expanded  = NumExpanded;
+				s.generated = NumGenerated;
+				s.pruned    = NumTableCutoffs;
+				s.f_bound   = frame.B == Infinity ? -1 : frame.B;
+				for( std::size_t d = 0; d <= depth; ++d )
+				{
+					for( int i = 0; i < Stack[d].num; ++i )
+					{
+						if( Stack[d].F[i] == Infinity || ( d < depth && i == Stack[d].best ) ) continue;
+						s.by_f.add( Stack[d].F[i], 1 );
+						s.by_g.add( Stack[d].g + Stack[d].actions[i]->GetCost(), 1 );
+						++s.frontier;
+					}
+				}
+				s.bytes     = { { "stack", Stack.capacity() * sizeof( Frame ) }, { "table", Table.bytes() } };
+				s.values    = { { "depth", double( depth ) }, { "best_f", F == Infinity ? -1. : double( F ) } };
+			} );
 		}
 
-		if( top.F <= frame.B )
+		if( F == Infinity || F > frame.B )
 		{
-			if( top.state.IsGoal() )
-			{
-				Solution.reserve( Stack.size() );
-				for( auto it = Stack.begin(), end = Stack.end(); it != end; ++it  )
-					Solution.push_back( it->child[0].action );
-				break;
-			}
-
-			Stack.emplace_back( top, std::min( frame.B, frame.child[1].F ) );
-			InitStackFrame( Stack.back() );
+			//Nothing left at or under the bound: back the best F up into the parent
+			if( depth == 0 )
+				break; //and the root's bound is infinite, so there's no solution
+
+			Table.Store( Key( state, frame.node ), frame.g, F );
+			Frame & parent = Stack[ --depth ];
+			state.UndoInPlace( *parent.actions[ parent.best ] );
+			parent.F[ parent.best ] = F;
+			parent.Select();
+			continue;
 		}
-		else
-		{
-			int ret = top.F;
-
-			if( Stack.size() == 1 )
-			{
-				if( frame.B == ret )
-					break;
-				else
-					frame.B = ret;
-				continue;
-			}
 
-			Stack.pop_back();
-			Stack.back().child[0].F = ret;
+		const Action & action = *frame.actions[ frame.best ];
+		state.ApplyInPlace( action );
+		if( state.IsGoal() )
+		{
+			Solution.reserve( depth + 1 );
+			for( std::size_t d = 0; d <= depth; ++d )
+				Solution.push_back( *Stack[d].actions[ Stack[d].best ] );
+			break;
 		}
+
+		if( ++depth == Stack.size() ) Stack.emplace_back();
+		Frame & child = Stack[ depth ];
+		Frame & top   = Stack[ depth - 1 ]; //emplace_back may have moved it
+		child.g    = top.g + action.GetCost();
+		child.f    = child.g + state.EstGoalDist();
+		child.B    = std::min( top.B, top.SecondF() );
+		child.node = PruneDuplicates ? Pruner::Next( top.node, action ) : top.node;
+		Expand( child, state, action, F );
 	}
 	return Solution;
 }
 };
 
+template< typename State > constexpr int RBFS< State >::Infinity;
+
 #endif
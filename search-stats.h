@@ -0,0 +1,212 @@
+#pragma once
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <condition_variable>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+//A snapshot of a search in progress, written as one JSON line.
+//
+//Counters the solver doesn't keep stay 0, and f_bound -1. With thread >= 0 the
+//counts are that thread's alone (the multithreaded solvers only sample thread 0).
+struct SearchSample
+{
+	const char * solver  = "";
+	int          thread  = -1;
+	double       seconds = 0; //since the reporter started
+
+	uint64_t expanded   = 0;
+	uint64_t generated  = 0;
+	uint64_t duplicates = 0;
+	uint64_t reopened   = 0;
+	uint64_t pruned     = 0;
+
+	int64_t  f_bound  = -1; //lowest f on the frontier, or the iteration's limit
+	uint64_t frontier = 0;  //open entries, stale ones included
+	uint64_t closed   = 0;  //states stored
+
+	//Frontier entries by value, count[i] at base + i
+	struct Histogram
+	{
+		int64_t                 base = 0;
+		std::vector< uint64_t > count;
+
+		void add( int64_t value, uint64_t n )
+		{
+			if( count.empty() ) base = value;
+			if( value < base )
+			{
+				count.insert( count.begin(), std::size_t( base - value ), 0 );
+				base = value;
+			}
+			if( std::size_t( value - base ) >= count.size() ) count.resize( std::size_t( value - base ) + 1, 0 );
+			count[ std::size_t( value - base ) ] += n;
+		}
+	};
+	Histogram by_f, by_g;
+
+	std::vector< std::pair< const char *, uint64_t > > bytes;  //by structure
+	std::vector< std::pair< const char *, double > >   values; //anything else the solver has
+
+	//Add a BucketQueue's entries to the frontier size and histograms
+	template< typename Queue >
+	void AddFrontier( const Queue & queue )
+	{
+		frontier += queue.size();
+		queue.for_each_bucket( [&]( std::size_t f, std::size_t g, std::size_t n )
+		{
+			by_f.add( int64_t( f ), n );
+			by_g.add( int64_t( g ), n );
+		} );
+		if( !queue.empty() && ( f_bound < 0 || int64_t( queue.front_f() ) < f_bound ) )
+			f_bound = int64_t( queue.front_f() );
+	}
+
+	void Write( FILE * out ) const
+	{
+		fprintf( out, "{\"solver\": \"%s\", \"thread\": %d, \"seconds\": %.3f, \"expanded\": %llu, \"generated\": %llu, "
+		              "\"duplicates\": %llu, \"reopened\": %llu, \"pruned\": %llu, \"f_bound\": %lld, \"frontier\": %llu, \"closed\": %llu",
+		         solver, thread, seconds, (unsigned long long)expanded, (unsigned long long)generated,
+		         (unsigned long long)duplicates, (unsigned long long)reopened, (unsigned long long)pruned,
+		         (long long)f_bound, (unsigned long long)frontier, (unsigned long long)closed );
+
+		fprintf( out, ", \"bytes\": {" );
+		for( std::size_t i = 0; i < bytes.size(); ++i )
+			fprintf( out, "%s\"%s\": %llu", i ? ", " : "", bytes[i].first, (unsigned long long)bytes[i].second );
+		fprintf( out, "}" );
+
+		WriteHistogram( out, "by_f", by_f );
+		WriteHistogram( out, "by_g", by_g );
+
+		for( auto & value : values )
+		{
+			if( std::isfinite( value.second ) ) fprintf( out, ", \"%s\": %.17g", value.first, value.second );
+			else                                fprintf( out, ", \"%s\": null",  value.first );
+		}
+		fprintf( out, "}\n" );
+		fflush( out );
+	}
+
+	private:
+	static void WriteHistogram( FILE * out, const char * name, const Histogram & h )
+	{
+		fprintf( out, ", \"%s\": {\"base\": %lld, \"count\": [", name, (long long)h.base );
+		for( std::size_t i = 0; i < h.count.size(); ++i )
+			fprintf( out, "%s%llu", i ? ", " : "", (unsigned long long)h.count[i] );
+		fprintf( out, "]}" );
+	}
+};
+
+//Live statistics for graphing a solve while it runs.
+//
+//Solvers keep counting in their own members as before and hold a SearchStats
+//pointer. Request() (from the reporter thread each Interval, or from a signal
+//handler) raises a flag; the solver polls it at its periodic check, every hundred or
+//so expansions, and when it's up fills in a SearchSample and Publish()es it. So the
+//search loop reads one flag that's written once per sample, on a line of its own,
+//and the reporter never touches the solver's structures.
+struct SearchStats
+{
+	SearchStats() : requested( false ) {}
+	~SearchStats() { Stop(); }
+
+	SearchStats( const SearchStats & ) = delete;
+	SearchStats & operator=( const SearchStats & ) = delete;
+
+	//Solver side: is a sample wanted?
+	bool Wanted() const { return requested.load( std::memory_order_relaxed ); }
+
+	//Solver side: fill( SearchSample & ) and hand the sample to the reporter
+	template< typename Fill >
+	void Publish( Fill fill )
+	{
+		SearchSample sample;
+		fill( sample );
+		sample.seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+		std::lock_guard< std::mutex > lock( mutex );
+		latest = std::move( sample );
+		++published;
+		requested.store( false, std::memory_order_relaxed );
+		ready.notify_one();
+	}
+
+	//Ask for a sample at the solver's next check. Lock free, so signal handlers may call it.
+	void Request() { requested.store( true, std::memory_order_relaxed ); }
+
+	//Write each published sample to out, and request one every interval seconds (0 for
+	//only on Request())
+	void Start( FILE * out, double interval )
+	{
+		Stop();
+		start    = std::chrono::steady_clock::now();
+		stopping = false;
+		reporter = std::thread( [this, out, interval]{ Report( out, interval ); } );
+	}
+
+	void Stop()
+	{
+		if( !reporter.joinable() ) return;
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			stopping = true;
+			ready.notify_one();
+		}
+		reporter.join();
+	}
+
+	private:
+	static_assert( ATOMIC_BOOL_LOCK_FREE == 2, "Request() must be safe in a signal handler" );
+
+	alignas( 64 ) std::atomic< bool > requested;
+	char pad[ 64 - sizeof( std::atomic< bool > ) ]; //the rest is the reporter's
+
+	std::mutex              mutex;
+	std::condition_variable ready;
+	SearchSample            latest;
+	uint64_t                published = 0;
+	bool                    stopping  = false;
+	std::thread             reporter;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	void Report( FILE * out, double interval )
+	{
+		auto period  = std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::duration< double >( interval ) );
+		auto next    = std::chrono::steady_clock::now() + period;
+		uint64_t written = 0;
+
+		std::unique_lock< std::mutex > lock( mutex );
+		while( !stopping )
+		{
+			auto now = std::chrono::steady_clock::now();
+			if( interval > 0 && now >= next )
+			{
+				Request();
+				next = now + period;
+			}
+
+			auto pending = [&]{ return stopping || published != written; };
+			if( interval > 0 ) ready.wait_until( lock, next, pending );
+			else               ready.wait( lock, pending );
+
+			if( published != written )
+			{
+				written = published;
+				SearchSample sample = latest;
+				lock.unlock();
+				sample.Write( out );
+				lock.lock();
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,331 @@
+#pragma once
+#ifndef SLIDING_K_PUZZLE_H
+#define SLIDING_K_PUZZLE_H
+#include <array>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#include "hash.h"
+#include "zobrist.h"
+#include "move-table.h"
+#include "sliding-puzzle.h"
+
+//Sliding puzzle with K interchangeable blanks.
+//
+//The goal has the blanks in cells 0..K-1 and tile t in cell t for t >= K. Blanks are
+//all stored as 0, so arrangements that only differ by which blank is where are one
+//state. An action is a blank's cell and the direction it moves in, which is the same
+//whichever blank sits there, so it can be inverted and numbered without the state.
+//
+//Moving a tile down or up costs Costs::Vertical, left or right Costs::Horizontal.
+//The estimate is Manhattan distance over the tiles with each axis weighted by its
+//cost: every move changes one tile's distance by one along its axis, so it never
+//overestimates.
+struct UnitMoveCosts
+{
+	constexpr static int Vertical   = 1;
+	constexpr static int Horizontal = 1;
+};
+
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs = UnitMoveCosts >
+struct SlidingKPuzzleAction
+{
+	static_assert( K >= 1 && K < N * M, "needs at least one blank and one tile" );
+
+	typedef SlidingMoveTable< N, M > Moves;
+
+	constexpr static std::size_t MaxBranch   = K * Moves::Dirs; //maximum out-degree of state graph
+	constexpr static std::size_t MaxInBranch = K * Moves::Dirs; //reversible, so in=out
+
+	typedef std::array< const SlidingKPuzzleAction*, MaxBranch > Actions;
+
+	//Directions are the blank's, as in SlidingMoveTable: 0 up, 1 down, 2 left, 3 right, 4 none
+	uint8_t cell;
+	uint8_t dir;
+
+	constexpr SlidingKPuzzleAction( unsigned c = 0, unsigned d = Moves::None ) : cell( uint8_t( c ) ), dir( uint8_t( d ) ) {}
+	bool operator==( const SlidingKPuzzleAction & o ) const { return cell == o.cell && dir == o.dir; };
+	bool operator!=( const SlidingKPuzzleAction & o ) const { return !( *this == o ); };
+
+	int GetCost() const { return dir < 2 ? Costs::Vertical : Costs::Horizontal; }
+
+	//The same blank moving back
+	SlidingKPuzzleAction Inverse() const
+	{
+		return dir == Moves::None ? *this : SlidingKPuzzleAction( cell + SlidingMoves< N, M >.offset[ dir ], dir ^ 1 );
+	}
+
+	//Dense numbering for packed storage: 0..NumIndices-1, NumIndices for no action
+	constexpr static std::size_t NumIndices = N * M * Moves::Dirs;
+	std::size_t Index() const { return dir == Moves::None ? NumIndices : cell * Moves::Dirs + dir; }
+	static SlidingKPuzzleAction FromIndex( std::size_t i )
+	{
+		if( i >= NumIndices ) return {};
+		return { unsigned( i / Moves::Dirs ), unsigned( i % Moves::Dirs ) };
+	}
+};
+
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs >
+std::ostream & operator<<(std::ostream &os, const SlidingKPuzzleAction< N, M, K, Costs > & a )
+{
+	static const char * names[] = { "UP", "DOWN", "LEFT", "RIGHT" };
+	if( a.dir < 4 ) os << names[ a.dir ] << "@" << int( a.cell );
+	return os;
+}
+
+//Every action, for AvailableActions to point into
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs >
+struct SlidingKActionTable
+{
+	typedef SlidingKPuzzleAction< N, M, K, Costs > Action;
+	Action actions[ N * M ][ Action::Moves::Dirs ];
+
+	constexpr SlidingKActionTable() : actions{}
+	{
+		for( unsigned cell = 0; cell < N * M; ++cell )
+			for( unsigned d = 0; d < Action::Moves::Dirs; ++d )
+				actions[ cell ][ d ] = Action( cell, d );
+	}
+};
+
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs >
+constexpr SlidingKActionTable< N, M, K, Costs > SlidingKActions = SlidingKActionTable< N, M, K, Costs >();
+
+//N rows by M columns with K blanks
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs = UnitMoveCosts >
+struct SlidingKPuzzleState
+{
+	typedef SlidingKPuzzleAction< N, M, K, Costs > Action;
+
+	constexpr static std::size_t NumStates = factorial( N * M ) / factorial( K );
+
+	//API for AStarSolve
+	typename Action::Actions AvailableActions( Action PrevAction = Action{} ) const
+	{
+		typename Action::Actions ret{};
+		auto act = ret.data();
+		Action undo = PrevAction.Inverse();
+		for( blanks_t left = blanks; left; left &= left - 1 )
+		{
+			unsigned cell = unsigned( __builtin_ctzll( left ) );
+			for( unsigned i = 0; i < Moves.num_moves[ cell ][ Moves.None ]; ++i )
+			{
+				unsigned d = Moves.moves[ cell ][ Moves.None ][i];
+				unsigned to = cell + Moves.offset[d];
+				if( ( blanks >> to ) & 1 ) continue; //blank onto blank changes nothing
+				if( cell == undo.cell && d == undo.dir ) continue;
+				*(act++) = &SlidingKActions< N, M, K, Costs >.actions[ cell ][ d ];
+			}
+		}
+		return ret;
+	}
+
+	SlidingKPuzzleState Apply( const Action & a ) const
+	{
+		SlidingKPuzzleState ret( *this );
+		ret.MoveBlank( a );
+		return ret;
+	}
+
+	//In place Apply and its undo, for depth first searches that walk a single state
+	void ApplyInPlace( const Action & a ) { MoveBlank( a ); }
+	void UndoInPlace ( const Action & a ) { MoveBlank( a.Inverse() ); }
+
+	//Implementation details
+
+	//Tiles are packed TileBits apiece, row major, blanks are 0
+	constexpr static unsigned NumCells = N * M;
+	constexpr static unsigned TileBits = BitsFor( NumCells );
+	static_assert( NumCells * TileBits <= 128, "board doesn't fit in a packed 128 bit word" );
+	static_assert( NumCells <= 64, "blank cells are a 64 bit mask" );
+
+	typedef typename PackedBoardWord< ( NumCells * TileBits > 64 ) >::type board_t;
+	typedef typename std::conditional< ( NumCells > 32 ), uint64_t, uint32_t >::type blanks_t;
+
+	board_t  board;
+	uint64_t hash;   //Zobrist hash of the tiles, kept up to date by Apply
+	blanks_t blanks; //bit per blank cell
+
+	SlidingKPuzzleState( )
+		: board( 0 )
+		, hash( 0 )
+		, blanks( 0 )
+		, GoalDist( 0 )
+	{
+	}
+	void init()
+	{
+		//Initial state, all in order
+		board    = 0;
+		hash     = 0;
+		blanks   = blanks_t( ( uint64_t(1) << K ) - 1 );
+		GoalDist = 0;
+		for( unsigned i = K; i < NumCells; ++i )
+		{
+			board |= board_t( i ) << ( i * TileBits );
+			hash  ^= Zobrist< NumCells >( i, i );
+		}
+	}
+
+	//Arrange the board as tiles[ cell ], values below K for blanks (e.g. a benchmark instance)
+	void set( const unsigned char * tiles )
+	{
+		board  = 0;
+		hash   = 0;
+		blanks = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			if( tiles[i] < K )
+			{
+				blanks |= blanks_t(1) << i;
+				continue;
+			}
+			board |= board_t( tiles[i] ) << ( i * TileBits );
+			hash  ^= Zobrist< NumCells >( i, tiles[i] );
+		}
+		UpdateEstimate();
+	}
+
+	unsigned char get( unsigned i ) const
+	{
+		return (unsigned char)( ( board >> ( i * TileBits ) ) & TileMask );
+	}
+
+	int EstGoalDist() const { return GoalDist; };
+
+	//Recompute the estimate from scratch
+	void UpdateEstimate() { GoalDist = DoEstGoalDist(); }
+
+	//Weighted Manhattan distance to another arrangement, for searches toward something other than the goal
+	int EstDistTo( const SlidingKPuzzleState & target ) const
+	{
+		unsigned char cell_of_tile[ NumCells ];
+		for( unsigned i = 0; i < NumCells; ++i )
+			cell_of_tile[ target.get( i ) ] = (unsigned char)i;
+
+		int dist = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			unsigned val = get( i );
+			if( val ) dist += CellDist( i, cell_of_tile[ val ] );
+		}
+		return dist;
+	}
+
+	bool IsGoal() const
+	{
+		return GoalDist == 0;
+	}
+
+	private:
+	constexpr static const SlidingMoveTable< N, M > & Moves = SlidingMoves< N, M >;
+	constexpr static unsigned TileMask = ( 1u << TileBits ) - 1;
+
+	int GoalDist;
+
+	static int CellDist( unsigned a, unsigned b )
+	{
+		return Costs::Vertical   * abs( int( Moves.row[a] ) - int( Moves.row[b] ) )
+		     + Costs::Horizontal * abs( int( Moves.col[a] ) - int( Moves.col[b] ) );
+	}
+
+	int DoEstGoalDist() const
+	{
+		int dist = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			unsigned val = get( i );
+			if( val ) dist += CellDist( i, val );
+		}
+		return dist;
+	}
+
+	//The blank at a.cell swaps with the tile next to it in direction a.dir
+	void MoveBlank( const Action & a )
+	{
+		unsigned to   = a.cell;                        //tile moves into the blank...
+		unsigned from = to + Moves.offset[ a.dir ];   //...from here
+		board_t  val  = ( board >> ( from * TileBits ) ) & TileMask;
+
+		board  ^= ( val << ( from * TileBits ) ) ^ ( val << ( to * TileBits ) );
+		blanks ^= ( blanks_t(1) << from ) | ( blanks_t(1) << to );
+		hash   ^= Zobrist< NumCells >( from, unsigned( val ) ) ^ Zobrist< NumCells >( to, unsigned( val ) );
+
+		//One step along a single axis, so the unweighted delta scaled by that axis' cost
+		GoalDist += a.GetCost() * Moves.delta[ unsigned( val ) ][ to ][ a.dir ];
+	}
+};
+
+//Moves of different blanks that touch disjoint cells commute, so every interleaving of
+//them reaches the same state at the same cost. Of two such moves in a row only the
+//order with the lower Index() first is kept; the automaton state is the last move.
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs >
+struct DuplicatePruner< SlidingKPuzzleState< N, M, K, Costs > >
+{
+	typedef SlidingKPuzzleAction< N, M, K, Costs > Action;
+	typedef int32_t Node;
+
+	static Node Start() { return Node( Action::NumIndices ); }
+
+	static bool Commute( const Action & a, const Action & b )
+	{
+		unsigned a_to = a.cell + SlidingMoves< N, M >.offset[ a.dir ];
+		unsigned b_to = b.cell + SlidingMoves< N, M >.offset[ b.dir ];
+		return a.cell != b.cell && a.cell != b_to && a_to != b.cell && a_to != b_to;
+	}
+
+	//Keeps the actions that aren't the second half of a swapped pair, packed to the front in order
+	static void Filter( Node node, typename Action::Actions & actions )
+	{
+		if( node == Start() ) return;
+		Action prev = Action::FromIndex( std::size_t( node ) );
+		std::size_t kept = 0;
+		for( auto paction : actions )
+			if( paction && !( paction->Index() < std::size_t( node ) && Commute( prev, *paction ) ) )
+				actions[ kept++ ] = paction;
+		while( kept < actions.size() ) actions[ kept++ ] = nullptr;
+	}
+
+	static Node Next( Node, const Action & action ) { return Node( action.Index() ); }
+};
+
+template< unsigned N, unsigned M, unsigned K, typename Costs >
+bool operator==( const SlidingKPuzzleState<N,M,K,Costs> & lhs, const SlidingKPuzzleState<N,M,K,Costs> & rhs )
+{
+	//The board alone determines the blanks
+	return lhs.board == rhs.board;
+}
+
+namespace std
+{
+	template< unsigned N, unsigned M, unsigned K, typename Costs > struct hash< SlidingKPuzzleState<N,M,K,Costs> >
+	{
+		size_t operator() ( const SlidingKPuzzleState<N,M,K,Costs> & state ) const
+		{
+			return state.hash;
+		}
+	};
+}
+
+template< unsigned int N, unsigned int M, unsigned int K, typename Costs >
+std::ostream & operator<<(std::ostream &os, const SlidingKPuzzleState<N,M,K,Costs> & t )
+{
+	for( unsigned n = 0; n < N; ++n )
+	{
+		for( unsigned m = 0; m < M; ++m )
+			os << std::setw(2) << (int)t.get( n * M + m ) << " ";
+		os << "\n";
+	}
+	os << std::endl;
+
+	return os;
+}
+
+//Two blank puzzle, as the K = 2 case
+template< unsigned int N, unsigned int M >
+using Sliding2PuzzleState = SlidingKPuzzleState< N, M, 2 >;
+
+#endif
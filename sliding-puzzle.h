@@ -5,8 +5,22 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+
+#if defined( __AVX2__ ) || defined( __SSE4_1__ )
+#include <immintrin.h>
+#endif
 
 #include "hash.h"
+#include "zobrist.h"
+#include "linear-conflict.h"
+#include "pattern-database.h"
+#include "expand.h"
+#include "move-fsm.h"
+#include "move-table.h"
 	
 
 struct SlidingPuzzleAction
@@ -34,6 +48,14 @@ struct SlidingPuzzleAction
 	bool operator==( const SlidingPuzzleAction & o ) const { return dir == o.dir; };
 	bool operator!=( const SlidingPuzzleAction & o ) const { return dir != o.dir; };
 
+	//The move that undoes this one (UP<->DOWN, LEFT<->RIGHT)
+	SlidingPuzzleAction Inverse() const { return dir == NUM_HoleDirection ? dir : HoleDirection( dir ^ 1 ); }
+
+	//Dense numbering for packed storage: 0..NumIndices-1, NumIndices for no action
+	constexpr static std::size_t NumIndices = MaxBranch;
+	std::size_t Index() const { return dir; }
+	static SlidingPuzzleAction FromIndex( std::size_t i ) { return HoleDirection( i ); }
+
 	static SlidingPuzzleAction UP    ;
 	static SlidingPuzzleAction DOWN  ;
 	static SlidingPuzzleAction LEFT  ;
@@ -45,6 +67,32 @@ SlidingPuzzleAction SlidingPuzzleAction::DOWN  = HOLE_DOWN;
 SlidingPuzzleAction SlidingPuzzleAction::LEFT  = HOLE_LEFT;
 SlidingPuzzleAction SlidingPuzzleAction::RIGHT = HOLE_RIGHT;
 
+//AvailableActions for each hole cell and previous direction, ready to copy out
+template< unsigned N, unsigned M >
+struct SlidingActionTable
+{
+	typedef SlidingPuzzleAction Action;
+	Action * actions[ N * M ][ Action::MaxBranch + 1 ][ Action::MaxBranch ];
+
+	constexpr SlidingActionTable() : actions{}
+	{
+		for( unsigned cell = 0; cell < N * M; ++cell )
+			for( unsigned prev = 0; prev <= Action::MaxBranch; ++prev )
+				for( unsigned i = 0; i < Action::MaxBranch; ++i )
+				{
+					unsigned d = SlidingMoves< N, M >.moves[ cell ][ prev ][i];
+					actions[ cell ][ prev ][i] = d == Action::HOLE_UP    ? &Action::UP
+					                           : d == Action::HOLE_DOWN  ? &Action::DOWN
+					                           : d == Action::HOLE_LEFT  ? &Action::LEFT
+					                           : d == Action::HOLE_RIGHT ? &Action::RIGHT
+					                           : nullptr;
+				}
+	}
+};
+
+template< unsigned N, unsigned M >
+constexpr SlidingActionTable< N, M > SlidingActions = SlidingActionTable< N, M >();
+
 std::ostream & operator<<(std::ostream &os, const SlidingPuzzleAction & a )
 {
 	switch( a.dir )
@@ -71,8 +119,20 @@ constexpr std::size_t factorial(std::size_t n) {
 	    return n == 0 ? 1  :  n * factorial(n-1); 
 }
 
-//N rows by M columns
-template< unsigned int N, unsigned int M>
+//Number of bits needed to store the values 0..n-1
+constexpr unsigned BitsFor( std::size_t n ) {
+	    return n <= 1 ? 0 : 1 + BitsFor( ( n + 1 ) / 2 );
+}
+
+//Packed board storage: a single 64 bit word when it fits, otherwise a 128 bit word.
+//The 128 bit type is only 8-byte aligned so it doesn't pad the state out to 16 bytes.
+__extension__ typedef unsigned __int128 uint128_board_t __attribute__(( aligned( 8 ) ));
+
+template< bool Wide > struct PackedBoardWord        { typedef uint64_t        type; };
+template<>            struct PackedBoardWord< true > { typedef uint128_board_t type; };
+
+//N rows by M columns. LinearConflict adds row and column conflicts to Manhattan distance.
+template< unsigned int N, unsigned int M, bool LinearConflict = false >
 struct SlidingPuzzleState
 {
 	typedef SlidingPuzzleAction Action;
@@ -82,13 +142,9 @@ struct SlidingPuzzleState
 	//API for AStarSolve
 	Action::Actions AvailableActions( Action PrevAction = Action{}  ) const
 	{
-		Action::Actions ret = { nullptr, nullptr, nullptr, nullptr };
-		auto act = ret.data();
-		if( n > 0   && PrevAction != Action::DOWN  ) *(act++) = &Action::UP   ;
-		if( n < N-1 && PrevAction != Action::UP    ) *(act++) = &Action::DOWN ;
-		if( m > 0   && PrevAction != Action::RIGHT ) *(act++) = &Action::LEFT ;
-		if( m < M-1 && PrevAction != Action::LEFT  ) *(act++) = &Action::RIGHT;
-
+		Action::Actions ret;
+		auto & actions = SlidingActions< N, M >.actions[ n * M + m ][ PrevAction.dir ];
+		std::copy( std::begin( actions ), std::end( actions ), ret.begin() );
 		return ret;
 	}
 
@@ -99,26 +155,97 @@ struct SlidingPuzzleState
 		return SlidingPuzzleState( *this, a.dir );
 	}
 
+	//Batched Apply: children for each of actions (nullptrs skipped) into out, returns how many.
+	//With plain Manhattan distance each child is a few table lookups from this state.
+	std::size_t ApplyAll( const Action::Actions & actions, SlidingPuzzleState * out ) const
+	{
+		if( LinearConflict || PDB )
+		{
+			std::size_t count = 0;
+			for( auto paction : actions )
+				if( paction ) out[ count++ ] = Apply( *paction );
+			return count;
+		}
+
+		//Each child moves the tile at from into the hole
+		unsigned hole = n * M + m;
+		std::size_t count = 0;
+		for( auto paction : actions )
+		{
+			if( !paction ) continue;
+			unsigned from = hole + Moves.offset[ paction->dir ];
+			unsigned val  = get( from );
+
+			SlidingPuzzleState & child = out[ count++ ];
+			child.board    = board ^ ( board_t( val ) << ( from * TileBits ) ) ^ ( board_t( val ) << ( hole * TileBits ) );
+			child.hash     = hash ^ Zobrist< NumCells >( from, val ) ^ Zobrist< NumCells >( hole, val );
+			child.n        = index_t( Moves.row[ from ] );
+			child.m        = index_t( Moves.col[ from ] );
+			child.GoalDist = GoalDist + Moves.delta[ val ][ hole ][ paction->dir ];
+		}
+		return count;
+	}
+
+	//In place Apply and its undo, for depth first searches that walk a single state
+	void ApplyInPlace( const Action & a ) { MoveHole( a.dir ); }
+	void UndoInPlace ( const Action & a ) { MoveHole( a.Inverse().dir ); }
+
 	//Implementation details
 	
-	//N rows of M columns
-	typedef std::array< std::array< unsigned char, M>, N > arr_t;
-	arr_t arr;
+	//Tiles are packed TileBits apiece, row major, tile at (n,m) in bits [ (n*M+m)*TileBits, ... )
+	constexpr static unsigned NumCells = N * M;
+	constexpr static unsigned TileBits = BitsFor( NumCells );
+	static_assert( NumCells * TileBits <= 128, "board doesn't fit in a packed 128 bit word" );
+
+	typedef typename PackedBoardWord< ( NumCells * TileBits > 64 ) >::type board_t;
+	board_t board;
+
+	//Zobrist hash of the tiles (the hole is implied), kept up to date by Apply
+	uint64_t hash;
+
+	//When set, estimates come from this additive pattern database instead of Manhattan distance
+	typedef PatternDatabase< N, M > PatternDB;
+	static const PatternDB * PDB;
 
 	SlidingPuzzleState( )
-		: m( 0 )
-	    , n( 0 )
+		: board( 0 )
+		, hash( 0 )
+		, n( 0 )
+		, m( 0 )
 		, GoalDist( 0 )
 	{
 	}
 	void init()
 	{
 		//Initial state, all in order
-		unsigned char v=0;
-		for( auto & row : arr )
-			for( auto & val : row )
-				val = v++;
+		board = 0;
+		hash  = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			board |= board_t( i ) << ( i * TileBits );
+			if( i ) hash ^= Zobrist< NumCells >( i, i );
+		}
+	}
+
+	//Arrange the board as tiles[ cell ], 0 for the hole (e.g. a benchmark instance)
+	void set( const unsigned char * tiles )
+	{
+		board = 0;
+		hash  = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			board |= board_t( tiles[i] ) << ( i * TileBits );
+			if( tiles[i] ) hash ^= Zobrist< NumCells >( i, tiles[i] );
+			else           { n = index_t( i / M ); m = index_t( i % M ); }
+		}
+		UpdateEstimate();
+	}
+
+	unsigned char get( unsigned i ) const
+	{
+		return (unsigned char)( ( board >> ( i * TileBits ) ) & TileMask );
 	}
+	unsigned char get( index_t n, index_t m ) const { return get( n * M + m ); }
 
 
 	//coords of 0
@@ -126,107 +253,289 @@ struct SlidingPuzzleState
 
 	int EstGoalDist() const { return GoalDist; };
 
+	//Recompute the estimate from scratch, e.g. after PDB changes
+	void UpdateEstimate() { GoalDist = DoEstGoalDist(); }
+
+	//Which heuristic EstGoalDist() is using, so checkpoints aren't resumed under another
+	static uint64_t HeuristicId() { return PDB ? PDB->Id() : LinearConflict ? 2 : 1; }
+
+	//Manhattan distance to another arrangement, for searches toward something other than the goal
+	int EstDistTo( const SlidingPuzzleState & target ) const
+	{
+		unsigned char cell_of_tile[ NumCells ];
+		for( unsigned i = 0; i < NumCells; ++i )
+			cell_of_tile[ target.get( i ) ] = (unsigned char)i;
+
+		int dist = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			unsigned val = get( i );
+			if( !val ) continue;
+			unsigned t = cell_of_tile[ val ];
+			dist += abs( int( i / M ) - int( t / M ) ) + abs( int( i % M ) - int( t % M ) );
+		}
+		return dist;
+	}
+
 	bool IsGoal() const 
 	{
 		return GoalDist == 0;
 	}
 
 	private:
+	constexpr static const SlidingMoveTable< N, M > & Moves = SlidingMoves< N, M >;
+	static_assert( Action::MaxBranch == SlidingMoveTable< N, M >::Dirs, "one table column per action" );
+
+	constexpr static unsigned TileMask = ( 1u << TileBits ) - 1;
+
+	//Manhattan distance of tile val from cell (n,m)
+	static int TileDist( unsigned char val, int n, int m )
+	{
+		int n_ = val / M;
+		int m_ = val % M;
+		return abs( n_ - n ) + abs( m_ - m );
+	}
+
 	int DoEstGoalDist() const 
 	{
+		if( PDB )
+		{
+			unsigned char cell_of_tile[ NumCells ];
+			for( unsigned i = 0; i < NumCells; ++i )
+				cell_of_tile[ get( i ) ] = (unsigned char)i;
+			return PDB->Evaluate( cell_of_tile );
+		}
+
 		//Esimate the "number of moves" needed to get to the goal state
 		int dist = 0;
-		for( index_t n = 0; n < N; ++n )
+		if( LinearConflict )
 		{
-			for( index_t m = 0; m < M; ++m )
-			{
-				//n,m are the actual coordinates
-				//The value at this index
-				auto val = arr[n][m];
-				index_t n_ = val / M;
-				index_t m_ = val % M;
-				//n_,m_ are the coordinates of val
-
-				//manhattan distance of moves to put this piece where it belongs
-				dist += abs( n_ - n ) + abs( m_ - m );
-			}
+			for( unsigned n = 0; n < N; ++n ) dist += RowConflicts( n );
+			for( unsigned m = 0; m < M; ++m ) dist += ColConflicts( m );
 		}
+
+		//manhattan distance of moves to put each piece where it belongs (the hole doesn't count)
+		int32_t vals[ PaddedCells ] = {};
+		for( unsigned i = 0; i < NumCells; ++i )
+			vals[i] = get( i );
+		return dist + ManhattanKernel( vals );
+	}
+
+	//Cells rounded up to whole 8 lane vectors
+	constexpr static unsigned PaddedCells = ( NumCells + 7 ) & ~7u;
+
+	//x / M and x % M for small non-negative x, as a multiply and shift
+	constexpr static int32_t DivMagic = 65536 / M + 1;
+
+#if defined( __SSE4_1__ )
+	static __m128i DivM( __m128i x ) { return _mm_srli_epi32( _mm_mullo_epi32( x, _mm_set1_epi32( DivMagic ) ), 16 ); }
+	static __m128i ModM( __m128i x, __m128i q ) { return _mm_sub_epi32( x, _mm_mullo_epi32( q, _mm_set1_epi32( M ) ) ); }
+
+	//|row(a)-row(b)| + |col(a)-col(b)| per lane
+	static __m128i Dist4( __m128i ar, __m128i ac, __m128i br, __m128i bc )
+	{
+		return _mm_add_epi32( _mm_abs_epi32( _mm_sub_epi32( ar, br ) ), _mm_abs_epi32( _mm_sub_epi32( ac, bc ) ) );
+	}
+#endif
+#if defined( __AVX2__ )
+	static __m256i DivM( __m256i x ) { return _mm256_srli_epi32( _mm256_mullo_epi32( x, _mm256_set1_epi32( DivMagic ) ), 16 ); }
+	static __m256i ModM( __m256i x, __m256i q ) { return _mm256_sub_epi32( x, _mm256_mullo_epi32( q, _mm256_set1_epi32( M ) ) ); }
+#endif
+
+	//Sum of tile distances over a board unpacked into vals (zero padded to PaddedCells)
+	static int ManhattanKernel( const int32_t * vals )
+	{
+#if defined( __AVX2__ )
+		__m256i sum  = _mm256_setzero_si256();
+		__m256i cell = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+		for( unsigned i = 0; i < PaddedCells; i += 8 )
+		{
+			__m256i v  = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( vals + i ) );
+			__m256i vr = DivM( v ),    vc = ModM( v, vr );
+			__m256i cr = DivM( cell ), cc = ModM( cell, cr );
+			__m256i d  = _mm256_add_epi32( _mm256_abs_epi32( _mm256_sub_epi32( vr, cr ) ), _mm256_abs_epi32( _mm256_sub_epi32( vc, cc ) ) );
+			//The hole and the padding are zeros
+			sum  = _mm256_add_epi32( sum, _mm256_andnot_si256( _mm256_cmpeq_epi32( v, _mm256_setzero_si256() ), d ) );
+			cell = _mm256_add_epi32( cell, _mm256_set1_epi32( 8 ) );
+		}
+		__m128i s = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+		s = _mm_hadd_epi32( s, s );
+		s = _mm_hadd_epi32( s, s );
+		return _mm_cvtsi128_si32( s );
+#elif defined( __SSE4_1__ )
+		__m128i sum  = _mm_setzero_si128();
+		__m128i cell = _mm_setr_epi32( 0, 1, 2, 3 );
+		for( unsigned i = 0; i < PaddedCells; i += 4 )
+		{
+			__m128i v  = _mm_loadu_si128( reinterpret_cast< const __m128i* >( vals + i ) );
+			__m128i vr = DivM( v ),    vc = ModM( v, vr );
+			__m128i cr = DivM( cell ), cc = ModM( cell, cr );
+			sum  = _mm_add_epi32( sum, _mm_andnot_si128( _mm_cmpeq_epi32( v, _mm_setzero_si128() ), Dist4( vr, vc, cr, cc ) ) );
+			cell = _mm_add_epi32( cell, _mm_set1_epi32( 4 ) );
+		}
+		sum = _mm_hadd_epi32( sum, sum );
+		sum = _mm_hadd_epi32( sum, sum );
+		return _mm_cvtsi128_si32( sum );
+#else
+		int dist = 0;
+		for( unsigned i = 0; i < NumCells; ++i )
+			if( vals[i] ) dist += TileDist( (unsigned char)vals[i], i / M, i % M );
 		return dist;
+#endif
 	}
 
 	int GoalDist;// = DoEstGoalDist();
 
 	SlidingPuzzleState( const SlidingPuzzleState & o, Action::HoleDirection dir )
-		: arr ( o.arr )
-		, n   ( o.n )
-		, m   ( o.m )
-		, GoalDist( o.GoalDist )
+		: SlidingPuzzleState( o )
+	{
+		MoveHole( dir );
+	}
+
+	void MoveHole( Action::HoleDirection dir )
+	{
+		index_t on = n, om = m;
+
+		unsigned to   = on * M + om;             //tile moves into the old hole...
+		unsigned from = to + Moves.offset[ dir ]; //...from the hole's new location
+		n = index_t( Moves.row[ from ] );
+		m = index_t( Moves.col[ from ] );
+		board_t  val  = ( board >> ( from * TileBits ) ) & TileMask;
+
+		//A vertical move only changes the two rows' contents, a horizontal one the two columns'
+		bool vertical = ( on != n );
+		if( LinearConflict && !PDB )
+			GoalDist -= vertical ? RowConflicts( n ) + RowConflicts( on ) : ColConflicts( m ) + ColConflicts( om );
+
+		//Apply to tile arrangement: the hole is all zero bits, so xor moves the tile
+		board ^= ( val << ( from * TileBits ) ) ^ ( val << ( to * TileBits ) );
+		hash  ^= Zobrist< NumCells >( from, unsigned( val ) ) ^ Zobrist< NumCells >( to, unsigned( val ) );
 
+		if( PDB )
+		{
+			GoalDist += PatternDelta( (unsigned char)val, from );
+			return;
+		}
+		GoalDist += Moves.delta[ unsigned( val ) ][ to ][ dir ];
+		if( LinearConflict )
+			GoalDist += vertical ? RowConflicts( n ) + RowConflicts( on ) : ColConflicts( m ) + ColConflicts( om );
+	}
+
+	//Linear conflict moves in row n / column m, looked up by the line's code (see LineConflictTable)
+	int RowConflicts( unsigned n ) const
+	{
+		std::size_t code = 0;
+		for( unsigned m = 0; m < M; ++m )
+		{
+			unsigned val = get( n * M + m );
+			code = code * ( M + 1 ) + ( val && val / M == n ? val % M : M );
+		}
+		return LineConflicts< M >( code );
+	}
+	int ColConflicts( unsigned m ) const
 	{
-		//New location of hole
-		switch( dir )
+		std::size_t code = 0;
+		for( unsigned n = 0; n < N; ++n )
 		{
-			case Action::HOLE_UP:
-				n -= 1;
-				break;
-			case Action::HOLE_DOWN:
-				n += 1;
-				break;
-			case Action::HOLE_LEFT:
-				m -= 1;
-				break;
-			case Action::HOLE_RIGHT:
-				m += 1;
-				break;
-			default:
-				break;
+			unsigned val = get( n * M + m );
+			code = code * ( N + 1 ) + ( val && val % M == m ? val / M : N );
 		}
+		return LineConflicts< N >( code );
+	}
 
-		unsigned char oldval = 0;//arr[o.n][o.m];
-		unsigned char newval = arr[  n][  m];
+	//Change in val's pattern value now that val has moved out of cell from
+	int PatternDelta( unsigned char val, unsigned from ) const
+	{
+		unsigned p = PDB->pattern_of[ val ];
+		if( p == PatternDB::NoPattern ) return 0;
 
+		unsigned char pos[ NumCells ];
+		for( unsigned i = 0; i < NumCells; ++i )
+		{
+			auto tile = get( i );
+			if( PDB->pattern_of[ tile ] == p ) pos[ PDB->slot_of[ tile ] ] = (unsigned char)i;
+		}
+		int after = PDB->Lookup( p, pos );
+		pos[ PDB->slot_of[ val ] ] = (unsigned char)from;
+		return after - PDB->Lookup( p, pos );
+	}
+};
 
-		//Apply to tile arrangement
-		std::swap( arr[n][m], arr[o.n][o.m] );
+template< unsigned int N, unsigned int M, bool LC >
+const PatternDatabase< N, M > * SlidingPuzzleState< N, M, LC >::PDB = nullptr;
 
-		unsigned char old_n = oldval / M;
-		unsigned char old_m = oldval % M; 
+template< unsigned int N, unsigned int M, bool LC >
+struct BatchExpand< SlidingPuzzleState< N, M, LC > >
+{
+	typedef SlidingPuzzleState< N, M, LC > State;
+	typedef typename State::Action Action;
 
-		unsigned char new_n = newval / M;
-		unsigned char new_m = newval % M; 
+	static void Expand( const State & state, const typename Action::Actions & actions, Successors< State > & out )
+	{
+		std::copy( actions.begin(), actions.end(), out.actions.begin() );
+		out.size = state.ApplyAll( actions, out.states.data() );
+	}
+};
+
+//Duplicate pruning for the hole's moves, compiled the first time it's used from the
+//duplicate strings of up to MaxLength moves
+template< unsigned int N, unsigned int M, bool LC >
+struct DuplicatePruner< SlidingPuzzleState< N, M, LC > >
+{
+	typedef SlidingPuzzleAction Action;
+	typedef MoveFSM< Action::MaxBranch > FSM;
+	typedef typename FSM::Node Node;
 
-		unsigned char lessDist = ( abs( old_n - o.n ) + abs( old_m - o.m ) + abs( new_n -   n ) + abs( new_m -   m ) );
-		unsigned char moreDist = ( abs( old_n -   n ) + abs( old_m -   m ) + abs( new_n - o.n ) + abs( new_m - o.m ) );
+	constexpr static unsigned MaxLength = 10;
 
-		GoalDist -= lessDist; 
-		GoalDist += moreDist; 
+	static const FSM & Get()
+	{
+		//Index order: UP, DOWN, LEFT, RIGHT
+		static const FSM fsm = FSM::Build( GridDuplicateStrings( { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } }, MaxLength ) );
+		return fsm;
+	}
+
+	static Node Start() { return FSM::Start; }
+
+	//Keeps the actions that don't complete a duplicate, packed to the front in order
+	static void Filter( Node node, typename Action::Actions & actions )
+	{
+		const FSM & fsm = Get();
+		std::size_t kept = 0;
+		for( auto paction : actions )
+			if( paction && fsm.Next( node, paction->Index() ) != FSM::Pruned )
+				actions[ kept++ ] = paction;
+		while( kept < actions.size() ) actions[ kept++ ] = nullptr;
 	}
+
+	static Node Next( Node node, const Action & action ) { return Get().Next( node, action.Index() ); }
 };
 
-template<unsigned N, unsigned M> 
-bool operator==( const SlidingPuzzleState<N,M> & lhs, const SlidingPuzzleState<N,M> & rhs )
+template<unsigned N, unsigned M, bool LC> 
+bool operator==( const SlidingPuzzleState<N,M,LC> & lhs, const SlidingPuzzleState<N,M,LC> & rhs )
 {
-	return lhs.n == rhs.n && lhs.m == rhs.m && lhs.arr == rhs.arr;
+	//The board alone determines the hole's coords
+	return lhs.board == rhs.board;
 }
 
 namespace std
 {
-	template<unsigned N, unsigned M> struct hash< SlidingPuzzleState<N,M> >
+	template<unsigned N, unsigned M, bool LC> struct hash< SlidingPuzzleState<N,M,LC> >
 	{
-		size_t operator() ( const SlidingPuzzleState<N,M> & state ) const
+		size_t operator() ( const SlidingPuzzleState<N,M,LC> & state ) const
 		{
-			return hash< typename SlidingPuzzleState<N,M>::arr_t >()( state.arr ) ;
+			return state.hash;
 		}
 	};
 }
 
-template< unsigned int N, unsigned int M>
-std::ostream & operator<<(std::ostream &os, const SlidingPuzzleState<N,M> & t )
+template< unsigned int N, unsigned int M, bool LC >
+std::ostream & operator<<(std::ostream &os, const SlidingPuzzleState<N,M,LC> & t )
 {
-	for( auto & row : t.arr )
+	for( unsigned n = 0; n < N; ++n )
 	{
-		for( auto & val : row )
-			os << std::setw(2) << (int)val << " ";
+		for( unsigned m = 0; m < M; ++m )
+			os << std::setw(2) << (int)t.get( n, m ) << " ";
 		os << "\n";
 	}
 	os << std::endl;
@@ -0,0 +1,354 @@
+#pragma once
+#ifndef SMASTAR_SOLVE_H
+#define SMASTAR_SOLVE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+#include "move-fsm.h"
+#include "search-stats.h"
+
+//Memory bounded A* in the style of SMA* (Russell 1992)
+//
+//A* over a search tree held in a fixed pool of nodes sized from MemoryBudget. When
+//the pool runs out, the worst leaf (highest f, shallowest) is dropped and its f is
+//backed up into its parent as the parent's "forgotten" value. The parent then
+//goes back on the frontier under that value, and when it comes up again the
+//dropped children are regenerated, each with f no lower than the forgotten value.
+//
+//f values only ever stand for lower bounds on the paths below a node, so the first
+//goal to come off the frontier is optimal, as long as the budget holds the path to it.
+template< typename State >
+struct SMAStar
+{
+	SearchStats * Stats = nullptr; //sampled every 100 expansions when set
+
+	std::size_t MemoryBudget = std::size_t(1) << 30; //bytes for nodes and frontier entries
+
+	//Search statistics, reset by each Solve
+	std::size_t NumExpanded    = 0;
+	std::size_t NumGenerated   = 0;
+	std::size_t NumPruned      = 0; //leaves dropped to stay in budget
+	std::size_t NumRegenerated = 0; //expansions that brought back dropped children
+	std::size_t MaxNodes       = 0; //pool size the budget allows
+	std::size_t PeakNodes      = 0;
+
+	typedef typename State::Action Action;
+
+	//Skip successors the state's duplicate pruning automaton rules out. SMA* keeps no
+	//closed list, so without this every transposition is a separate subtree.
+	bool PruneDuplicates = true;
+	typedef ::DuplicatePruner< State > Pruner;
+	typedef typename Pruner::Node      PrunerNode;
+
+	static_assert( Action::MaxBranch <= 32, "children in memory are tracked in a 32 bit mask" );
+
+	constexpr static int Infinity = std::numeric_limits<int>::max();
+
+	struct Node
+	{
+		State    state;
+		Action   action; //from parent
+		Node *   parent;
+		int      g;
+		int      f;
+		int      forgotten;   //lowest f of children dropped since they were last generated
+		int      depth;
+		PrunerNode node;      //automaton state for the path to here
+		uint32_t present;     //Actions() slots with a child in memory
+		uint8_t  slot;        //this node's slot in its parent
+		uint8_t  children;    //in memory
+		bool     expanded;
+		uint8_t  in;          //bit per NodeSet holding the node
+		Node *   next[2];     //links in Open and Leaves
+		Node *   prev[2];
+
+		//Frontier value: f until expanded, then the best dropped child's
+		int key() const { return expanded ? forgotten : f; }
+	};
+
+	//Nodes by ( key, depth ) in intrusive lists, one per key and depth. Keys and depths
+	//are small, so the best or worst is a short scan over the list heads, and insert and
+	//erase are O(1) and allocate nothing. A node's key mustn't change while it's in.
+	template< int Link >
+	struct NodeSet
+	{
+		struct Row
+		{
+			std::vector< Node* > heads; //by depth
+			std::size_t         count = 0;
+		};
+		std::vector< Row > rows;     //by finite key
+		Row                infinite;
+		std::size_t        num = 0;
+
+		bool        empty() const { return num == 0; }
+		std::size_t size()  const { return num; }
+		bool        contains( const Node * n ) const { return n->in & ( 1 << Link ); }
+
+		void clear() { rows.clear(); infinite = Row{}; num = 0; }
+
+		Row & row( int key )
+		{
+			if( key == Infinity ) return infinite;
+			if( std::size_t( key ) >= rows.size() ) rows.resize( std::size_t( key ) + 1 );
+			return rows[ key ];
+		}
+
+		void insert( Node * n )
+		{
+			if( contains( n ) ) return;
+			Row & r = row( n->key() );
+			if( std::size_t( n->depth ) >= r.heads.size() ) r.heads.resize( std::size_t( n->depth ) + 1, nullptr );
+			Node *& head = r.heads[ n->depth ];
+			n->prev[ Link ] = nullptr;
+			n->next[ Link ] = head;
+			if( head ) head->prev[ Link ] = n;
+			head = n;
+			n->in |= 1 << Link;
+			++r.count;
+			++num;
+		}
+
+		void erase( Node * n )
+		{
+			if( !contains( n ) ) return;
+			Row & r = row( n->key() );
+			if( n->prev[ Link ] ) n->prev[ Link ]->next[ Link ] = n->next[ Link ];
+			else                  r.heads[ n->depth ]          = n->next[ Link ];
+			if( n->next[ Link ] ) n->next[ Link ]->prev[ Link ] = n->prev[ Link ];
+			n->in &= ~( 1 << Link );
+			--r.count;
+			--num;
+		}
+
+		//Lowest key, deepest first
+		Node * best() const
+		{
+			for( const Row & r : rows )
+				if( r.count ) return Deepest( r );
+			return infinite.count ? Deepest( infinite ) : nullptr;
+		}
+
+		//Highest key, shallowest first, passing over skip
+		Node * worst( const Node * skip ) const
+		{
+			if( Node * n = Shallowest( infinite, skip ) ) return n;
+			for( auto r = rows.rbegin(); r != rows.rend(); ++r )
+				if( Node * n = Shallowest( *r, skip ) ) return n;
+			return nullptr;
+		}
+
+		template< typename Fn >
+		void for_each( Fn fn ) const
+		{
+			for( const Row & r : rows )
+				for( Node * head : r.heads )
+					for( Node * n = head; n; n = n->next[ Link ] ) fn( n );
+			for( Node * head : infinite.heads )
+				for( Node * n = head; n; n = n->next[ Link ] ) fn( n );
+		}
+
+		private:
+		static Node * Deepest( const Row & r )
+		{
+			for( auto h = r.heads.rbegin(); h != r.heads.rend(); ++h )
+				if( *h ) return *h;
+			return nullptr;
+		}
+		static Node * Shallowest( const Row & r, const Node * skip )
+		{
+			if( !r.count ) return nullptr;
+			for( Node * head : r.heads )
+				for( Node * n = head; n; n = n->next[ Link ] )
+					if( n != skip ) return n;
+			return nullptr;
+		}
+	};
+
+	//Rough cost of one node: the node itself, links included, and its Free entry
+	constexpr static std::size_t NodeBytes = sizeof( Node ) + sizeof( Node* );
+
+	std::vector< Node >              Pool;   //reserved up front, so nodes never move
+	std::vector< Node* >             Free;   //dropped nodes
+	NodeSet< 0 >                     Open;   //unexpanded nodes, and expanded ones with dropped children
+	NodeSet< 1 >                     Leaves; //nodes without children in memory (but the root)
+	Node *                           Root = nullptr;
+
+	std::size_t Available() const { return Free.size() + ( MaxNodes - Pool.size() ); }
+
+	Node * Alloc()
+	{
+		Node * n;
+		if( Free.empty() )
+		{
+			Pool.emplace_back();
+			n = &Pool.back();
+		}
+		else
+		{
+			n = Free.back();
+			Free.pop_back();
+		}
+		PeakNodes = std::max( PeakNodes, MaxNodes - Available() );
+		return n;
+	}
+
+	//Drop the worst leaf other than keep, backing its value up into its parent
+	bool PruneWorst( const Node * keep )
+	{
+		Node * leaf = Leaves.worst( keep );
+		if( !leaf ) return false;
+
+		Node * parent = leaf->parent;
+		Leaves.erase( leaf );
+		Open.erase( leaf );
+
+		Open.erase( parent );
+		parent->forgotten = std::min( parent->forgotten, leaf->key() );
+		parent->present  &= ~( uint32_t(1) << leaf->slot );
+		--parent->children;
+		Open.insert( parent );
+		if( parent->children == 0 && parent != Root )
+			Leaves.insert( parent );
+
+		Free.push_back( leaf );
+		++NumPruned;
+		return true;
+	}
+
+	//node's actions after duplicate pruning, the same each time, so slots stay put
+	typename Action::Actions Actions( const Node * node ) const
+	{
+		auto actions = node->state.AvailableActions( node->action );
+		if( PruneDuplicates ) Pruner::Filter( node->node, actions );
+		return actions;
+	}
+
+	//Generate node's children that aren't in memory
+	void Expand( Node * node )
+	{
+		bool regenerate = node->expanded;
+		int  base       = node->key();
+		if( regenerate ) ++NumRegenerated;
+		else             ++NumExpanded;
+
+		auto actions = Actions( node );
+		for( std::size_t i = 0; i < actions.size(); ++i )
+		{
+			if( !actions[i] || ( node->present & ( uint32_t(1) << i ) ) ) continue;
+
+			Node * child = Alloc();
+			child->state     = node->state.Apply( *actions[i] );
+			child->action    = *actions[i];
+			child->parent    = node;
+			child->g         = node->g + actions[i]->GetCost();
+			child->f         = std::max( base, child->g + child->state.EstGoalDist() );
+			child->forgotten = Infinity;
+			child->depth     = node->depth + 1;
+			child->node      = PruneDuplicates ? Pruner::Next( node->node, *actions[i] ) : node->node;
+			child->present   = 0;
+			child->slot      = uint8_t( i );
+			child->children  = 0;
+			child->expanded  = false;
+			child->in        = 0;
+			++NumGenerated;
+
+			node->present |= uint32_t(1) << i;
+			++node->children;
+			Open.insert( child );
+			Leaves.insert( child );
+		}
+
+		node->expanded  = true;
+		node->forgotten = Infinity;
+
+		//A dead end stays a leaf, so it can be dropped to back Infinity up
+		if( node->children == 0 && node != Root )
+			Leaves.insert( node );
+	}
+
+std::vector< Action > Solve( const State & initial )
+{
+	NumExpanded = NumGenerated = NumPruned = NumRegenerated = PeakNodes = 0;
+
+	//Room for at least the root and one full set of children
+	MaxNodes = std::max( MemoryBudget / NodeBytes, std::size_t( Action::MaxBranch + 1 ) );
+	Pool.clear();
+	Pool.reserve( MaxNodes );
+	Free.clear();
+	Open.clear();
+	Leaves.clear();
+
+	Root = Alloc();
+	*Root = Node{ initial, Action{}, nullptr, 0, initial.EstGoalDist(), Infinity, 0, Pruner::Start(), 0, 0, 0, false, 0, {}, {} };
+	Open.insert( Root );
+
+	std::vector< Action > ret;
+	std::size_t numChecks = 0;
+
+	while( !Open.empty() )
+	{
+		Node * node = Open.best();
+		if( node->key() == Infinity ) break; //nothing left below any bound
+
+		if( !node->expanded && node->state.IsGoal() )
+		{
+			for( Node * n = node; n->parent; n = n->parent )
+				ret.push_back( n->action );
+			std::reverse( ret.begin(), ret.end() );
+			break;
+		}
+
+		//Make room for every child before touching the node's place in the sets
+		while( Available() < Action::MaxBranch )
+		{
+			if( !PruneWorst( node ) )
+			{
+				std::cerr << "SMA*: memory budget of " << MaxNodes << " nodes can't hold the search path" << std::endl;
+				return ret;
+			}
+		}
+
+		//node may have just lost its last children to pruning, so look it up fresh
+		Open.erase( node );
+		Leaves.erase( node );
+		Expand( node );
+
+		if( ++numChecks % 100 == 0 && Stats && Stats->Wanted() )
+		{
+			Stats->Publish( [&]( SearchSample & s )
+			{
+				s.solver    = "smastar";
+				s.expanded  = NumExpanded;
+				s.generated = NumGenerated;
+				s.pruned    = NumPruned;
+				s.closed    = MaxNodes - Available();
+				s.frontier  = Open.size();
+				Open.for_each( [&]( const Node * n )
+				{
+					if( n->key() == Infinity ) return;
+					s.by_f.add( n->key(), 1 );
+					s.by_g.add( n->g, 1 );
+				} );
+				const Node * best = Open.best();
+				s.f_bound   = !best || best->key() == Infinity ? -1 : best->key();
+				s.bytes     = { { "nodes", Pool.capacity() * sizeof( Node ) },
+				                { "free",  Free.capacity() * sizeof( Node* ) } };
+				s.values    = { { "regenerated", double( NumRegenerated ) }, { "max_nodes", double( MaxNodes ) } };
+			} );
+		}
+	}
+
+	Open.clear();
+	Leaves.clear();
+	Pool.clear();
+	Pool.shrink_to_fit();
+	Free.clear();
+	return ret;
+}
+};
+
+#endif
@@ -0,0 +1,192 @@
+#pragma once
+#ifndef STATES_HASH_TABLE_H
+#define STATES_HASH_TABLE_H
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+#include <functional>
+
+#include "arena.h"
+
+//Flat open-addressing closed list.
+//
+//Nodes (State + MetaData) live inline in fixed-size chunks that are never moved,
+//so a StateAndMeta & stays valid for the life of the table. The probe array only
+//holds 32 bit node handles plus 32 bits of the hash, so growing the table just
+//rewrites the (small) probe array.
+//
+//Given an Arena, chunks are carved out of it and are never freed individually:
+//the arena's owner releases them in bulk.
+template< typename State, typename MetaData >
+struct StatesHashTable
+{
+	typedef std::pair< const State, MetaData > StateAndMeta;
+	typedef uint32_t handle_t;
+
+	constexpr static std::size_t ChunkBits = 16;
+	constexpr static std::size_t ChunkSize = std::size_t(1) << ChunkBits; //nodes per chunk
+	constexpr static std::size_t MaxSize   = std::numeric_limits< handle_t >::max(); //slots store handle + 1
+
+	struct Slot
+	{
+		handle_t handle; //node handle + 1, 0 == empty
+		uint32_t tag;    //upper hash bits, to skip most mismatches without touching the node
+	};
+
+	std::vector< StateAndMeta* > chunks;
+	std::vector< Slot >          slots;
+	std::size_t                  num_nodes = 0;
+	std::size_t                  mask      = 0;
+	std::size_t                  max_nodes = 0; //grow when num_nodes reaches this
+	float                        max_load_factor;
+	Arena *                      arena;
+
+	StatesHashTable( std::size_t capacity = std::size_t(1) << 20, float load_factor = 0.75f, Arena * arena = nullptr )
+		: max_load_factor( load_factor )
+		, arena( arena )
+	{
+		if( max_load_factor <= 0.f || max_load_factor >= 1.f ) max_load_factor = 0.75f;
+		rehash( capacity );
+	}
+
+	~StatesHashTable()
+	{
+		if( arena && std::is_trivially_destructible< StateAndMeta >::value )
+			return; //Nothing to do, the arena frees the chunks
+
+		for( auto chunk : chunks )
+		{
+			if( !std::is_trivially_destructible< StateAndMeta >::value )
+			{
+				std::size_t count = std::min( ChunkSize, num_nodes );
+				for( std::size_t i = 0; i < count; ++i )
+					chunk[i].~StateAndMeta();
+				num_nodes -= count;
+			}
+			if( !arena ) ::operator delete( chunk );
+		}
+	}
+
+	StatesHashTable( const StatesHashTable & ) = delete;
+	StatesHashTable & operator=( const StatesHashTable & ) = delete;
+
+	std::size_t size()     const { return num_nodes; }
+	std::size_t capacity() const { return slots.size(); }
+
+	StateAndMeta & operator[]( handle_t h )
+	{
+		return chunks[ h >> ChunkBits ][ h & ( ChunkSize - 1 ) ];
+	}
+
+	//Returns the handle of state, inserting it with default MetaData if it is new
+	handle_t get_handle( const State & state, bool & inserted )
+	{
+		if( num_nodes >= max_nodes )
+			rehash( max_nodes * 2 );
+
+		uint64_t hash = std::hash< State >()( state );
+		uint32_t tag  = uint32_t( hash >> 32 );
+		std::size_t i = std::size_t( hash ) & mask;
+		while( true )
+		{
+			Slot & slot = slots[i];
+			if( slot.handle == 0 )
+			{
+				handle_t h = emplace( state );
+				slot.handle = h + 1;
+				slot.tag    = tag;
+				inserted = true;
+				return h;
+			}
+			if( slot.tag == tag && (*this)[ slot.handle - 1 ].first == state )
+			{
+				inserted = false;
+				return slot.handle - 1;
+			}
+			i = ( i + 1 ) & mask;
+		}
+	}
+
+	handle_t get_handle( const State & state )
+	{
+		bool inserted;
+		return get_handle( state, inserted );
+	}
+
+	//inserts if doesn't exist and returns reference
+	StateAndMeta & get( const State & state )
+	{
+		return (*this)[ get_handle( state ) ];
+	}
+
+	//nullptr if state isn't in the table
+	StateAndMeta * find( const State & state )
+	{
+		uint64_t hash = std::hash< State >()( state );
+		uint32_t tag  = uint32_t( hash >> 32 );
+		for( std::size_t i = std::size_t( hash ) & mask; slots[i].handle != 0; i = ( i + 1 ) & mask )
+		{
+			if( slots[i].tag == tag && (*this)[ slots[i].handle - 1 ].first == state )
+				return &(*this)[ slots[i].handle - 1 ];
+		}
+		return nullptr;
+	}
+
+	std::size_t bytes() const
+	{
+		return chunks.size() * ChunkSize * sizeof( StateAndMeta )
+		     + slots.size() * sizeof( Slot )
+		     + chunks.capacity() * sizeof( StateAndMeta* );
+	}
+
+	double bytes_per_node() const
+	{
+		return num_nodes ? double( bytes() ) / num_nodes : 0.;
+	}
+
+	private:
+	handle_t emplace( const State & state )
+	{
+		if( num_nodes >= MaxSize )
+			throw std::length_error( "StatesHashTable: more nodes than 32 bit handles can address" );
+
+		std::size_t chunk = num_nodes >> ChunkBits;
+		if( chunk == chunks.size() )
+		{
+			void * p = arena ? arena->allocate( ChunkSize * sizeof( StateAndMeta ), alignof( StateAndMeta ) )
+			                 : ::operator new( ChunkSize * sizeof( StateAndMeta ) );
+			chunks.push_back( static_cast< StateAndMeta* >( p ) );
+		}
+
+		new ( &chunks[ chunk ][ num_nodes & ( ChunkSize - 1 ) ] ) StateAndMeta{ state, MetaData{} };
+		return handle_t( num_nodes++ );
+	}
+
+	void rehash( std::size_t capacity )
+	{
+		//Power of two number of slots, large enough for capacity nodes at max_load_factor
+		std::size_t n = 16;
+		while( n * max_load_factor < capacity ) n *= 2;
+
+		std::vector< Slot > old( n, Slot{ 0, 0 } );
+		old.swap( slots );
+		mask      = n - 1;
+		max_nodes = std::size_t( n * max_load_factor );
+
+		for( auto & slot : old )
+		{
+			if( slot.handle == 0 ) continue;
+			uint64_t hash = std::hash< State >()( (*this)[ slot.handle - 1 ].first );
+			std::size_t i = std::size_t( hash ) & mask;
+			while( slots[i].handle != 0 ) i = ( i + 1 ) & mask;
+			slots[i] = slot;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <sys/mman.h>
+
+//Fixed size, lossy transposition table for the depth first searches.
+//
+//Each 16 byte entry holds a 64 bit key, the lowest g the state has been seen at, and
+//the lowest f found below it when its subtree was last searched to completion
+//(the backed-up bound). Four entries share a 64 byte bucket, so a probe touches one
+//cache line. A store of a new key into a full bucket evicts the entry with the
+//highest g, whose subtree is the cheapest to search again.
+//
+//Keys are only compared, never verified against the state, so two states whose
+//keys collide share an entry.
+struct TranspositionTable
+{
+	struct Entry
+	{
+		uint64_t key;   //0 == empty
+		int32_t  g;
+		int32_t  bound;
+	};
+
+	constexpr static std::size_t BucketEntries = 4;
+	struct alignas( 64 ) Bucket
+	{
+		Entry entries[ BucketEntries ];
+	};
+
+	static_assert( sizeof( Entry ) == 16 && sizeof( Bucket ) == 64, "a bucket is one cache line" );
+
+	//Statistics
+	std::size_t NumProbes       = 0;
+	std::size_t NumHits         = 0;
+	std::size_t NumStores       = 0;
+	std::size_t NumReplacements = 0; //stores that evicted another key
+
+	TranspositionTable() = default;
+	explicit TranspositionTable( std::size_t bytes ) { resize( bytes ); }
+	~TranspositionTable() { release(); }
+
+	TranspositionTable( const TranspositionTable & ) = delete;
+	TranspositionTable & operator=( const TranspositionTable & ) = delete;
+
+	TranspositionTable( TranspositionTable && o ) : buckets( o.buckets ), mask( o.mask ) { o.buckets = nullptr; o.mask = 0; }
+	TranspositionTable & operator=( TranspositionTable && o )
+	{
+		std::swap( buckets, o.buckets );
+		std::swap( mask, o.mask );
+		return *this;
+	}
+
+	//Room for bytes worth of buckets (rounded down to a power of two), all empty
+	void resize( std::size_t bytes )
+	{
+		release();
+		NumProbes = NumHits = NumStores = NumReplacements = 0;
+		if( bytes < sizeof( Bucket ) ) return;
+		std::size_t n = 0;
+		while( sizeof( Bucket ) << ( n + 1 ) <= bytes ) ++n;
+
+		//Fresh anonymous pages are zero, i.e. empty, and only take RAM once touched
+		void * p = mmap( nullptr, sizeof( Bucket ) << n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if( p == MAP_FAILED ) return;
+		buckets = static_cast< Bucket* >( p );
+		mask    = ( std::size_t(1) << n ) - 1;
+	}
+
+	bool        empty() const { return buckets == nullptr; }
+	std::size_t bytes() const { return buckets ? ( mask + 1 ) * sizeof( Bucket ) : 0; }
+
+	const Entry * Probe( uint64_t key )
+	{
+		if( !buckets ) return nullptr;
+		key = Key( key );
+		++NumProbes;
+		Bucket & bucket = buckets[ key & mask ];
+		for( auto & e : bucket.entries )
+		{
+			if( e.key == key )
+			{
+				++NumHits;
+				return &e;
+			}
+		}
+		return nullptr;
+	}
+
+	//Record that key's subtree, reached at g, holds nothing below f = bound
+	void Store( uint64_t key, int g, int bound )
+	{
+		if( !buckets ) return;
+		key = Key( key );
+		++NumStores;
+		Bucket & bucket = buckets[ key & mask ];
+
+		Entry * victim = &bucket.entries[0];
+		for( auto & e : bucket.entries )
+		{
+			if( e.key == key )
+			{
+				//A cheaper path's bound says more; at the same g keep the tighter one
+				if( g < e.g )       { e.g = g; e.bound = bound; }
+				else if( g == e.g && bound > e.bound ) e.bound = bound;
+				return;
+			}
+			if( victim->key != 0 && ( e.key == 0 || e.g > victim->g ) )
+				victim = &e;
+		}
+		if( victim->key != 0 ) ++NumReplacements;
+		*victim = Entry{ key, g, bound };
+	}
+
+	private:
+	Bucket *    buckets = nullptr;
+	std::size_t mask    = 0;
+
+	//Spread the key's high bits into the bucket index too, and keep 0 for empty
+	static uint64_t Key( uint64_t key )
+	{
+		key ^= key >> 29;
+		return key ? key : 1;
+	}
+
+	void release()
+	{
+		if( buckets ) munmap( buckets, bytes() );
+		buckets = nullptr;
+		mask    = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include <cstddef>
+
+//Random keys for Zobrist hashing a board of Cells cells, each holding a value < Cells.
+//The hash of a board is the xor of keys[cell][value] over its cells, so moving a tile
+//updates it with two xors instead of rehashing the whole board.
+template< std::size_t Cells >
+struct ZobristTable
+{
+	uint64_t keys[ Cells ][ Cells ];
+
+	constexpr ZobristTable() : keys{}
+	{
+		//splitmix64, fixed seed so hashes are reproducible between runs
+		uint64_t x = 0x2545F4914F6CDD1DULL;
+		for( std::size_t c = 0; c < Cells; ++c )
+		{
+			for( std::size_t v = 0; v < Cells; ++v )
+			{
+				uint64_t z = ( x += 0x9E3779B97F4A7C15ULL );
+				z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+				z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+				keys[c][v] = z ^ ( z >> 31 );
+			}
+		}
+	}
+
+	constexpr uint64_t operator()( std::size_t cell, std::size_t value ) const { return keys[cell][value]; }
+};
+
+template< std::size_t Cells >
+constexpr ZobristTable< Cells > Zobrist = ZobristTable< Cells >();
+
+#endif